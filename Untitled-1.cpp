@@ -5,10 +5,38 @@
 #include <limits>
 #include <algorithm>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
 #include <set>
 #include <queue>
 #include <cmath>
 #include <stack>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <charconv>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <cerrno>
+#include <filesystem>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <csignal>
+#endif
 
 class Pipe {
 public:
@@ -28,21 +56,25 @@ public:
         return !underRepair && !inUse;
     }
     
-    double getCapacity() const {
-        if (underRepair) return 0.0;
+    int getCapacityUnits() const {
+        if (underRepair) return 0;
         
-        static const std::map<int, double> capacityTable = {
-            {500, 100.0},
-            {700, 300.0},
-            {1000, 700.0},
-            {1400, 1200.0}
+        static const std::map<int, int> capacityTable = {
+            {500, 100},
+            {700, 300},
+            {1000, 700},
+            {1400, 1200}
         };
         
         auto it = capacityTable.find(diameter);
         if (it != capacityTable.end()) {
             return it->second;
         }
-        return 0.0;
+        return 0;
+    }
+    
+    double getCapacity() const {
+        return getCapacityUnits();
     }
     
     double getWeight() const {
@@ -103,520 +135,3382 @@ Pipe* findAvailablePipe(int diameter) {
     return nullptr;
 }
 
-void addPipe() {
-    Pipe newPipe;
-    newPipe.id = nextPipeId++;
-    
-    std::cout << "Vvedite nazvanie truby: ";
-    std::getline(std::cin, newPipe.name);
-    
-    std::cout << "Vvedite dlinu truby (km): ";
-    while (!(std::cin >> newPipe.length) || newPipe.length <= 0) {
-        std::cout << "Nevernyj vvod. Vvedite polozhitelnoe chislo: ";
-        clearInputBuffer();
-    }
-    
-    std::cout << "Vvedite diametr truby (mm): ";
-    std::cout << "Dostupnye diametry: 500, 700, 1000, 1400" << std::endl;
-    while (!(std::cin >> newPipe.diameter) || 
-           (newPipe.diameter != 500 && newPipe.diameter != 700 && 
-            newPipe.diameter != 1000 && newPipe.diameter != 1400)) {
-        std::cout << "Nevernyj vvod. Vvedite odin iz dostupnyh diametrov (500, 700, 1000, 1400): ";
-        clearInputBuffer();
+// Dlina truby v fiksirovannoj tochke (metry) dlja celochislennogo poiska putej.
+const double LENGTH_FIXED_POINT_SCALE = 1000.0;
+const long long BLOCKED_LENGTH = -1;
+
+struct GraphEdge {
+    int from;
+    int to;
+    double capacity;
+    double weight;
+    long long capacityUnits;
+    long long lengthFixed;
+};
+
+// Kompaktnoe predstavlenie seti dlja analiza: KS zanumerovany indeksami 0..n-1
+// v porjadke vozrastanija ID, rebra hranjatsja v massive. Ne zavisit ot globalnyh
+// dannyh, poetomu odin i tot zhe graf mozhno chitat iz neskolkih potokov.
+struct NetworkGraph {
+    std::vector<int> stationIds;
+    std::vector<std::string> stationNames;
+    std::vector<int> stationClasses;
+    std::vector<GraphEdge> edges;
+    std::vector<std::vector<int>> outEdges;
+
+    int indexOf(int stationId) const {
+        auto it = std::lower_bound(stationIds.begin(), stationIds.end(), stationId);
+        if (it == stationIds.end() || *it != stationId) {
+            return -1;
+        }
+        return static_cast<int>(it - stationIds.begin());
     }
-    
-    newPipe.underRepair = false;
-    newPipe.inUse = false;
-    clearInputBuffer();
-    
-    pipes.push_back(newPipe);
-    logAction("Dobavlena truba ID: " + std::to_string(newPipe.id));
-    std::cout << "Truba uspeshno dobavlena! ID: " << newPipe.id << std::endl;
-}
+};
 
-void addCompressorStation() {
-    CompressorStation newStation;
-    newStation.id = nextStationId++;
-    
-    std::cout << "Vvedite nazvanie kompressornoj stancii: ";
-    std::getline(std::cin, newStation.name);
-    
-    std::cout << "Vvedite obshhee kolichestvo cehov: ";
-    while (!(std::cin >> newStation.totalWorkshops) || newStation.totalWorkshops <= 0) {
-        std::cout << "Nevernyj vvod. Vvedite polozhitelnoe celoe chislo: ";
-        clearInputBuffer();
+NetworkGraph buildNetworkGraph(const std::vector<Pipe>& pipeList,
+                               const std::vector<CompressorStation>& stationList,
+                               const std::vector<NetworkConnection>& connectionList) {
+    NetworkGraph graph;
+
+    std::vector<const CompressorStation*> sortedStations;
+    for (const auto& station : stationList) {
+        sortedStations.push_back(&station);
     }
-    
-    std::cout << "Vvedite kolichestvo rabotayushhih cehov: ";
-    while (!(std::cin >> newStation.workingWorkshops) || newStation.workingWorkshops < 0 || newStation.workingWorkshops > newStation.totalWorkshops) {
-        std::cout << "Nevernyj vvod. Vvedite chislo ot 0 do " << newStation.totalWorkshops << ": ";
-        clearInputBuffer();
+    std::sort(sortedStations.begin(), sortedStations.end(),
+              [](const CompressorStation* a, const CompressorStation* b) { return a->id < b->id; });
+    for (const auto* station : sortedStations) {
+        graph.stationIds.push_back(station->id);
+        graph.stationNames.push_back(station->name);
+        graph.stationClasses.push_back(station->stationClass);
     }
-    
-    std::cout << "Vvedite klass stancii: ";
-    while (!(std::cin >> newStation.stationClass) || newStation.stationClass <= 0) {
-        std::cout << "Nevernyj vvod. Vvedite polozhitelnoe celoe chislo: ";
-        clearInputBuffer();
+    graph.outEdges.resize(graph.stationIds.size());
+
+    std::vector<const Pipe*> sortedPipes;
+    for (const auto& pipe : pipeList) {
+        sortedPipes.push_back(&pipe);
     }
-    clearInputBuffer();
-    
-    stations.push_back(newStation);
-    logAction("Dobavlena KS ID: " + std::to_string(newStation.id));
-    std::cout << "Kompressornaja stancija uspeshno dobavlena! ID: " << newStation.id << std::endl;
-}
+    std::sort(sortedPipes.begin(), sortedPipes.end(),
+              [](const Pipe* a, const Pipe* b) { return a->id < b->id; });
 
-void displayAllObjects() {
-    std::cout << "\n=== TRUBY ===" << std::endl;
-    if (pipes.empty()) {
-        std::cout << "Net trub." << std::endl;
-    } else {
-        for (const auto& pipe : pipes) {
-            std::cout << "ID: " << pipe.id << ", Nazvanie: " << pipe.name 
-                      << ", Dlina: " << pipe.length << " km"
-                      << ", Diametr: " << pipe.diameter << " mm"
-                      << ", V remonte: " << (pipe.underRepair ? "Da" : "Net")
-                      << ", V ispolzovanii: " << (pipe.inUse ? "Da" : "Net")
-                      << ", Proizvoditelnost: " << pipe.getCapacity() << " ed." << std::endl;
+    for (const auto& conn : connectionList) {
+        int from = graph.indexOf(conn.fromStationId);
+        int to = graph.indexOf(conn.toStationId);
+        if (from < 0 || to < 0) {
+            continue;
         }
-    }
-    
-    std::cout << "\n=== KOMPRESSORNYE STANCII ===" << std::endl;
-    if (stations.empty()) {
-        std::cout << "Net kompressornyh stancij." << std::endl;
-    } else {
-        for (const auto& station : stations) {
-            double percent = (station.totalWorkshops - station.workingWorkshops) * 100.0 / station.totalWorkshops;
-            std::cout << "ID: " << station.id << ", Nazvanie: " << station.name
-                      << ", Ceha: " << station.workingWorkshops << "/" << station.totalWorkshops
-                      << ", Neispolzovano: " << percent << "%"
-                      << ", Klass: " << station.stationClass << std::endl;
+        GraphEdge edge{from, to, 0.0, 0.0, 0, 0};
+        auto it = std::lower_bound(sortedPipes.begin(), sortedPipes.end(), conn.pipeId,
+                                   [](const Pipe* pipe, int id) { return pipe->id < id; });
+        if (it != sortedPipes.end() && (*it)->id == conn.pipeId) {
+            edge.capacity = (*it)->getCapacity();
+            edge.weight = (*it)->getWeight();
+            edge.capacityUnits = (*it)->getCapacityUnits();
+            edge.lengthFixed = (*it)->underRepair
+                ? BLOCKED_LENGTH
+                : std::llround((*it)->length * LENGTH_FIXED_POINT_SCALE);
         }
+        graph.outEdges[from].push_back(static_cast<int>(graph.edges.size()));
+        graph.edges.push_back(edge);
     }
+    return graph;
 }
 
-void displayNetwork() {
-    std::cout << "\n=== GASOTRANSPORTNAYA SET ===" << std::endl;
-    if (connections.empty()) {
-        std::cout << "Set pusta." << std::endl;
-    } else {
-        for (const auto& conn : connections) {
-            std::cout << "KS " << conn.fromStationId << " -> KS " << conn.toStationId 
-                      << " (Truba ID: " << conn.pipeId << ")" << std::endl;
-        }
-    }
+NetworkGraph buildNetworkGraph() {
+    return buildNetworkGraph(pipes, stations, connections);
 }
 
-bool stationExists(int id) {
-    for (const auto& station : stations) {
-        if (station.id == id) {
-            return true;
-        }
-    }
-    return false;
+// Truby v remonte ne propuskajut gaz.
+bool usableEdge(const GraphEdge& edge) {
+    return edge.weight != std::numeric_limits<double>::infinity();
 }
 
-void connectStations() {
-    if (stations.size() < 2) {
-        std::cout << "Dolzhno byt minimum 2 KS dlja soedinenija." << std::endl;
-        return;
+enum class KernelMode { Floating, Integer };
+
+KernelMode activeKernel = KernelMode::Floating;
+
+template <typename Cap>
+Cap edgeCapacity(const GraphEdge& edge);
+
+template <>
+double edgeCapacity<double>(const GraphEdge& edge) {
+    return edge.capacity;
+}
+
+template <>
+long long edgeCapacity<long long>(const GraphEdge& edge) {
+    return edge.capacityUnits;
+}
+
+// Vozvrashhaet false dlja trub, ne propuskajushhih gaz.
+template <typename Weight>
+bool edgeWeight(const GraphEdge& edge, Weight& weight);
+
+template <>
+bool edgeWeight<double>(const GraphEdge& edge, double& weight) {
+    weight = edge.weight;
+    return edge.weight != std::numeric_limits<double>::infinity();
+}
+
+template <>
+bool edgeWeight<long long>(const GraphEdge& edge, long long& weight) {
+    weight = edge.lengthFixed;
+    return edge.lengthFixed != BLOCKED_LENGTH;
+}
+
+// Esli sourceSide zadan, v nego zapisyvaetsja storona minimalnogo razreza,
+// soderzhashhaja istochnik (vershiny, dostizhimye v ostatochnoj seti).
+// Dlja celochislennyh propusknyh sposobnostej ispolzuetsja masshtabirovanie:
+// snachala ishhutsja puti s ostatkom ne menshe poroga, porog umenshaetsja vdvoe.
+template <typename Cap>
+Cap maxFlowKernel(const NetworkGraph& graph, int source, int sink, std::vector<char>* sourceSide) {
+    const bool scaling = std::is_integral<Cap>::value;
+    size_t n = graph.stationIds.size();
+    std::vector<int> head(n, -1), next, target;
+    std::vector<Cap> residual;
+    const auto addArc = [&](int from, int to, Cap capacity) {
+        target.push_back(to);
+        residual.push_back(capacity);
+        next.push_back(head[from]);
+        head[from] = static_cast<int>(target.size()) - 1;
+    };
+    Cap largest = 0;
+    for (const auto& edge : graph.edges) {
+        Cap capacity = edgeCapacity<Cap>(edge);
+        addArc(edge.from, edge.to, capacity);
+        addArc(edge.to, edge.from, 0);
+        largest = std::max(largest, capacity);
     }
-    
-    std::cout << "Dostupnye diametry: 500, 700, 1000, 1400" << std::endl;
-    std::cout << "Vvedite diametr truby: ";
-    int diameter;
-    while (!(std::cin >> diameter) || 
-           (diameter != 500 && diameter != 700 && 
-            diameter != 1000 && diameter != 1400)) {
-        std::cout << "Nevernyj vvod. Vvedite odin iz dostupnyh diametrov (500, 700, 1000, 1400): ";
-        clearInputBuffer();
+
+    Cap threshold = 0;
+    if (scaling) {
+        threshold = 1;
+        while (threshold <= largest / 2) {
+            threshold *= 2;
+        }
     }
-    
-    Pipe* availablePipe = findAvailablePipe(diameter);
-    
-    if (!availablePipe) {
-        std::cout << "Net dostupnyh trub s diametrom " << diameter << " mm." << std::endl;
-        std::cout << "Sozdat novuju trubu? (1 - Da, 0 - Net): ";
-        int choice;
-        std::cin >> choice;
-        clearInputBuffer();
-        
-        if (choice == 1) {
-            addPipe();
-            if (!pipes.empty()) {
-                availablePipe = &pipes.back();
-                if (availablePipe->diameter != diameter) {
-                    std::cout << "Diametr novoj truby ne sovpadaet s trebuemym!" << std::endl;
-                    return;
+    const auto admissible = [&threshold, scaling](Cap remaining) {
+        return scaling ? remaining >= threshold : remaining > 0;
+    };
+
+    Cap maxFlow = 0;
+    std::vector<int> parentArc(n);
+    while (true) {
+        std::fill(parentArc.begin(), parentArc.end(), -1);
+        std::queue<int> q;
+        q.push(source);
+        parentArc[source] = -2;
+
+        while (!q.empty() && parentArc[sink] == -1) {
+            int current = q.front();
+            q.pop();
+            for (int arc = head[current]; arc != -1; arc = next[arc]) {
+                if (parentArc[target[arc]] == -1 && admissible(residual[arc])) {
+                    parentArc[target[arc]] = arc;
+                    q.push(target[arc]);
                 }
-            } else {
-                std::cout << "Oshibka pri sozdanii truby!" << std::endl;
-                return;
             }
-        } else {
-            return;
         }
+
+        if (parentArc[sink] == -1) {
+            if (scaling && threshold > 1) {
+                threshold /= 2;
+                continue;
+            }
+            if (sourceSide) {
+                sourceSide->assign(n, 0);
+                for (size_t v = 0; v < n; ++v) {
+                    (*sourceSide)[v] = (parentArc[v] != -1);
+                }
+            }
+            break;
+        }
+
+        Cap pathFlow = std::numeric_limits<Cap>::has_infinity ? std::numeric_limits<Cap>::infinity()
+                                                              : std::numeric_limits<Cap>::max();
+        for (int v = sink; v != source; v = target[parentArc[v] ^ 1]) {
+            pathFlow = std::min(pathFlow, residual[parentArc[v]]);
+        }
+        for (int v = sink; v != source; v = target[parentArc[v] ^ 1]) {
+            residual[parentArc[v]] -= pathFlow;
+            residual[parentArc[v] ^ 1] += pathFlow;
+        }
+        maxFlow += pathFlow;
     }
-    
-    std::cout << "Vvedite ID KS vhoda: ";
-    int fromId;
-    std::cin >> fromId;
-    
-    std::cout << "Vvedite ID KS vyhoda: ";
-    int toId;
-    std::cin >> toId;
-    clearInputBuffer();
-    
-    if (!stationExists(fromId)) {
-        std::cout << "KS s ID " << fromId << " ne sushhestvuet." << std::endl;
-        return;
-    }
-    
-    if (!stationExists(toId)) {
-        std::cout << "KS s ID " << toId << " ne sushhestvuet." << std::endl;
-        return;
+    return maxFlow;
+}
+
+template <typename Weight>
+class MinQueue {
+public:
+    void push(Weight key, int value) {
+        heap.push({key, value});
     }
-    
-    if (fromId == toId) {
-        std::cout << "Nelzja soedinit KS s samoj soboj." << std::endl;
-        return;
+
+    std::pair<Weight, int> pop() {
+        auto top = heap.top();
+        heap.pop();
+        return top;
     }
-    
-    for (const auto& conn : connections) {
-        if (conn.fromStationId == fromId && conn.toStationId == toId) {
-            std::cout << "Soedinenie uzhe sushhestvuet." << std::endl;
-            return;
-        }
+
+    bool empty() const {
+        return heap.empty();
     }
-    
-    availablePipe->inUse = true;
-    
-    NetworkConnection newConn(availablePipe->id, fromId, toId);
-    connections.push_back(newConn);
-    
-    logAction("Soedinenie: KS " + std::to_string(fromId) + " -> KS " + 
-              std::to_string(toId) + " (Truba ID: " + std::to_string(availablePipe->id) + ")");
-    std::cout << "KS uspeshno soedineny!" << std::endl;
-}
 
-void disconnectStations() {
-    if (connections.empty()) {
-        std::cout << "Net soedinenij dlja razryva." << std::endl;
-        return;
+private:
+    std::priority_queue<std::pair<Weight, int>, std::vector<std::pair<Weight, int>>,
+                        std::greater<std::pair<Weight, int>>> heap;
+};
+
+// Radix-kucha dlja celochislennyh kljuchej: v Dijkstra izvlekaemye kljuchi ne ubyvajut,
+// poetomu element pereraspredeljaetsja ne bolee 64 raz.
+template <>
+class MinQueue<long long> {
+public:
+    void push(long long key, int value) {
+        buckets[bucketOf(key)].push_back({key, value});
+        count++;
     }
-    
-    std::cout << "Vvedite ID KS vhoda: ";
-    int fromId;
-    std::cin >> fromId;
-    
-    std::cout << "Vvedite ID KS vyhoda: ";
-    int toId;
-    std::cin >> toId;
-    clearInputBuffer();
-    
-    for (auto it = connections.begin(); it != connections.end(); ++it) {
-        if (it->fromStationId == fromId && it->toStationId == toId) {
-            for (auto& pipe : pipes) {
-                if (pipe.id == it->pipeId) {
-                    pipe.inUse = false;
-                    break;
-                }
+
+    std::pair<long long, int> pop() {
+        if (buckets[0].empty()) {
+            size_t i = 1;
+            while (buckets[i].empty()) {
+                ++i;
             }
-            
-            connections.erase(it);
-            logAction("Razryv soedinenija: KS " + std::to_string(fromId) + " -> KS " + std::to_string(toId));
-            std::cout << "Soedinenie razorvano!" << std::endl;
-            return;
+            last = buckets[i][0].first;
+            for (const auto& item : buckets[i]) {
+                last = std::min(last, item.first);
+            }
+            for (const auto& item : buckets[i]) {
+                buckets[bucketOf(item.first)].push_back(item);
+            }
+            buckets[i].clear();
         }
+        auto top = buckets[0].back();
+        buckets[0].pop_back();
+        count--;
+        return top;
     }
-    
-    std::cout << "Soedinenie ne najdeno." << std::endl;
-}
 
-void topologicalSort() {
-    if (connections.empty()) {
-        std::cout << "Set pusta. Net chto sortirovat." << std::endl;
-        return;
-    }
-    
-    std::map<int, std::vector<int>> graph;
-    std::map<int, int> inDegree;
-    
-    for (const auto& station : stations) {
-        graph[station.id] = std::vector<int>();
-        inDegree[station.id] = 0;
+    bool empty() const {
+        return count == 0;
     }
-    
-    for (const auto& conn : connections) {
-        graph[conn.fromStationId].push_back(conn.toStationId);
-        inDegree[conn.toStationId]++;
+
+private:
+    std::vector<std::pair<long long, int>> buckets[65];
+    long long last = 0;
+    size_t count = 0;
+
+    size_t bucketOf(long long key) const {
+        unsigned long long diff = static_cast<unsigned long long>(key) ^ static_cast<unsigned long long>(last);
+        size_t bit = 0;
+        while (diff != 0) {
+            diff >>= 1;
+            ++bit;
+        }
+        return bit;
     }
-    
-    std::queue<int> zeroInDegree;
-    for (const auto& [node, degree] : inDegree) {
-        if (degree == 0) {
-            zeroInDegree.push(node);
+};
+
+template <typename Weight>
+bool shortestPathKernel(const NetworkGraph& graph, int start, int end,
+                        Weight& distance, std::vector<int>& path) {
+    const Weight UNREACHED = std::numeric_limits<Weight>::max();
+    size_t n = graph.stationIds.size();
+    std::vector<Weight> dist(n, UNREACHED);
+    std::vector<int> parent(n, -1);
+    MinQueue<Weight> pq;
+
+    dist[start] = 0;
+    pq.push(0, start);
+    while (!pq.empty()) {
+        auto [currentDist, current] = pq.pop();
+        if (currentDist > dist[current]) {
+            continue;
+        }
+        if (current == end) {
+            break;
+        }
+        for (int edgeIndex : graph.outEdges[current]) {
+            const GraphEdge& edge = graph.edges[edgeIndex];
+            Weight weight;
+            if (!edgeWeight<Weight>(edge, weight)) {
+                continue;
+            }
+            Weight newDist = currentDist + weight;
+            if (newDist < dist[edge.to]) {
+                dist[edge.to] = newDist;
+                parent[edge.to] = current;
+                pq.push(newDist, edge.to);
+            }
         }
     }
-    
-    std::vector<int> sortedOrder;
-    
+
+    if (dist[end] == UNREACHED) {
+        return false;
+    }
+    distance = dist[end];
+    path.clear();
+    for (int v = end; v != -1; v = parent[v]) {
+        path.push_back(v);
+    }
+    std::reverse(path.begin(), path.end());
+    return true;
+}
+
+double maxFlowOn(const NetworkGraph& graph, int source, int sink,
+                 std::vector<char>* sourceSide = nullptr,
+                 KernelMode mode = KernelMode::Floating) {
+    if (mode == KernelMode::Integer) {
+        return static_cast<double>(maxFlowKernel<long long>(graph, source, sink, sourceSide));
+    }
+    return maxFlowKernel<double>(graph, source, sink, sourceSide);
+}
+
+bool shortestPathOn(const NetworkGraph& graph, int start, int end,
+                    double& distance, std::vector<int>& path,
+                    KernelMode mode = KernelMode::Floating) {
+    if (mode == KernelMode::Integer) {
+        long long fixedDistance;
+        if (!shortestPathKernel<long long>(graph, start, end, fixedDistance, path)) {
+            return false;
+        }
+        distance = fixedDistance / LENGTH_FIXED_POINT_SCALE;
+        return true;
+    }
+    return shortestPathKernel<double>(graph, start, end, distance, path);
+}
+
+bool topologicalOrderOn(const NetworkGraph& graph, std::vector<int>& order) {
+    size_t n = graph.stationIds.size();
+    std::vector<int> inDegree(n, 0);
+    for (const auto& edge : graph.edges) {
+        inDegree[edge.to]++;
+    }
+
+    std::queue<int> zeroInDegree;
+    for (size_t v = 0; v < n; ++v) {
+        if (inDegree[v] == 0) {
+            zeroInDegree.push(static_cast<int>(v));
+        }
+    }
+
+    order.clear();
     while (!zeroInDegree.empty()) {
         int current = zeroInDegree.front();
         zeroInDegree.pop();
-        sortedOrder.push_back(current);
-        
-        for (int neighbor : graph[current]) {
-            inDegree[neighbor]--;
-            if (inDegree[neighbor] == 0) {
+        order.push_back(current);
+        for (int edgeIndex : graph.outEdges[current]) {
+            int neighbor = graph.edges[edgeIndex].to;
+            if (--inDegree[neighbor] == 0) {
                 zeroInDegree.push(neighbor);
             }
         }
     }
-    
-    if (sortedOrder.size() != stations.size()) {
-        std::cout << "V grafe obnaruzhen cikl! Topologicheskaja sortirovka nevozmozhna." << std::endl;
-        return;
-    }
-    
-    std::cout << "\n=== TOPOLOGICHESKAYA SORTIROVKA KS ===" << std::endl;
-    for (size_t i = 0; i < sortedOrder.size(); ++i) {
-        std::string stationName = "N/A";
-        for (const auto& station : stations) {
-            if (station.id == sortedOrder[i]) {
-                stationName = station.name;
-                break;
+    return order.size() == n;
+}
+
+// Opublikovannyj snimok grafa dlja servera zaprosov. Pisatel (osnovnoj potok)
+// sobiraet novyj graf i atomarno podmenjaet ukazatel; chitateli rabotajut so
+// svoej kopiej shared_ptr, poka ona im nuzhna.
+std::atomic<bool> snapshotPublishing(false);
+std::shared_ptr<const NetworkGraph> publishedGraph = std::make_shared<NetworkGraph>();
+
+void publishSnapshot() {
+    if (snapshotPublishing.load()) {
+        std::atomic_store(&publishedGraph, std::shared_ptr<const NetworkGraph>(
+            std::make_shared<NetworkGraph>(buildNetworkGraph())));
+    }
+}
+
+// Mutacii otmechajut izmenennye bloki po VERSION_CHUNK_SIZE obektov, chtoby
+// sledujushhaja versija seti kopirovala tolko ih. Udalenie sdvigaet vse
+// posledujushhie obekty, poetomu otmechaetsja ves hvost nachinaja s bloka udalenija.
+const size_t VERSION_CHUNK_SIZE = 256;
+
+struct ChangedChunks {
+    std::set<size_t> chunks;
+    size_t shiftedFrom = std::numeric_limits<size_t>::max();
+};
+
+ChangedChunks changedPipeChunks;
+ChangedChunks changedStationChunks;
+ChangedChunks changedConnectionChunks;
+
+template <typename T>
+void markChanged(ChangedChunks& changed, const std::vector<T>& items, const T& item) {
+    changed.chunks.insert(static_cast<size_t>(&item - items.data()) / VERSION_CHUNK_SIZE);
+}
+
+void markShifted(ChangedChunks& changed, size_t index) {
+    changed.shiftedFrom = std::min(changed.shiftedFrom, index / VERSION_CHUNK_SIZE);
+}
+
+void markAllChanged() {
+    markShifted(changedPipeChunks, 0);
+    markShifted(changedStationChunks, 0);
+    markShifted(changedConnectionChunks, 0);
+}
+
+void writeNetwork(std::ostream& file) {
+    file << std::setprecision(std::numeric_limits<double>::max_digits10);
+    file << nextPipeId << '\n';
+    file << nextStationId << '\n';
+
+    file << pipes.size() << '\n';
+    for (const auto& pipe : pipes) {
+        file << pipe.id << '\n';
+        file << pipe.name << '\n';
+        file << pipe.length << '\n';
+        file << pipe.diameter << '\n';
+        file << pipe.underRepair << '\n';
+        file << pipe.inUse << '\n';
+    }
+
+    file << stations.size() << '\n';
+    for (const auto& station : stations) {
+        file << station.id << '\n';
+        file << station.name << '\n';
+        file << station.totalWorkshops << '\n';
+        file << station.workingWorkshops << '\n';
+        file << station.stationClass << '\n';
+    }
+
+    file << connections.size() << '\n';
+    for (const auto& conn : connections) {
+        file << conn.pipeId << '\n';
+        file << conn.fromStationId << '\n';
+        file << conn.toStationId << '\n';
+    }
+}
+
+// Zapuskaet fn(begin, end) na neskolkih potokah, razbivaja [0, count) na bloki.
+template <typename Fn>
+void parallelFor(size_t count, size_t minChunk, Fn fn) {
+    size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+    threadCount = std::min(threadCount, (count + minChunk - 1) / std::max<size_t>(minChunk, 1));
+    if (threadCount <= 1) {
+        fn(size_t(0), count);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    size_t chunk = (count + threadCount - 1) / threadCount;
+    for (size_t begin = 0; begin < count; begin += chunk) {
+        size_t end = std::min(count, begin + chunk);
+        workers.emplace_back([&fn, begin, end]() { fn(begin, end); });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+bool readFileBlock(const std::string& filename, std::string& data) {
+    std::error_code ec;
+    if (!std::filesystem::is_regular_file(filename, ec)) {
+        return false;
+    }
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::streamsize size = file.tellg();
+    if (size < 0) {
+        return false;
+    }
+    file.seekg(0);
+    data.resize(static_cast<size_t>(size));
+    return static_cast<bool>(file.read(&data[0], size));
+}
+
+struct TextLine {
+    const char* begin;
+    const char* end;
+};
+
+template <typename T>
+bool parseField(const TextLine& line, T& value) {
+    const char* begin = line.begin;
+    while (begin < line.end && (*begin == ' ' || *begin == '\t')) ++begin;
+    const char* end = line.end;
+    while (end > begin && (end[-1] == ' ' || end[-1] == '\t')) --end;
+    auto result = std::from_chars(begin, end, value);
+    return result.ec == std::errc() && result.ptr == end;
+}
+
+bool parseField(const TextLine& line, bool& value) {
+    int flag;
+    if (!parseField(line, flag) || (flag != 0 && flag != 1)) {
+        return false;
+    }
+    value = (flag == 1);
+    return true;
+}
+
+// Format fajla strochnyj, a chislo strok na zapis fiksirovano, poetomu posle
+// razmetki strok kazhdaja sekcija razbiraetsja parallelno, a zatem parallelno
+// proverjaetsja celostnost ssylok. Tekushhaja set zamenjaetsja tolko pri uspehe.
+bool parseNetwork(const std::string& data, std::string& error) {
+    const size_t PIPE_LINES = 6, STATION_LINES = 5, CONNECTION_LINES = 3;
+    const size_t MIN_CHUNK = 4096;
+
+    std::vector<TextLine> lines;
+    lines.reserve(std::count(data.begin(), data.end(), '\n') + 1);
+    const char* cursor = data.data();
+    const char* dataEnd = data.data() + data.size();
+    while (cursor < dataEnd) {
+        const char* newline = static_cast<const char*>(std::memchr(cursor, '\n', dataEnd - cursor));
+        const char* lineEnd = newline ? newline : dataEnd;
+        const char* contentEnd = (lineEnd > cursor && lineEnd[-1] == '\r') ? lineEnd - 1 : lineEnd;
+        lines.push_back({cursor, contentEnd});
+        cursor = newline ? newline + 1 : dataEnd;
+    }
+
+    size_t pos = 0;
+    const auto readCount = [&](size_t& count, size_t linesPerRecord) {
+        long long value;
+        if (pos >= lines.size() || !parseField(lines[pos], value) || value < 0) {
+            return false;
+        }
+        ++pos;
+        if (static_cast<unsigned long long>(value) > (lines.size() - pos) / linesPerRecord) {
+            return false;
+        }
+        count = static_cast<size_t>(value);
+        return true;
+    };
+
+    int newNextPipeId, newNextStationId;
+    if (lines.size() < 2 || !parseField(lines[0], newNextPipeId) || !parseField(lines[1], newNextStationId)) {
+        error = "nevernyj zagolovok";
+        return false;
+    }
+    pos = 2;
+
+    size_t pipeCount, stationCount, connCount;
+    if (!readCount(pipeCount, PIPE_LINES)) {
+        error = "nevernaja sekcija trub";
+        return false;
+    }
+    size_t pipeStart = pos;
+    pos += pipeCount * PIPE_LINES;
+    if (!readCount(stationCount, STATION_LINES)) {
+        error = "nevernaja sekcija KS";
+        return false;
+    }
+    size_t stationStart = pos;
+    pos += stationCount * STATION_LINES;
+    if (!readCount(connCount, CONNECTION_LINES)) {
+        error = "nevernaja sekcija soedinenij";
+        return false;
+    }
+    size_t connStart = pos;
+
+    std::vector<Pipe> newPipes(pipeCount);
+    std::vector<CompressorStation> newStations(stationCount);
+    std::vector<NetworkConnection> newConnections(connCount);
+    std::atomic<size_t> badLine(std::numeric_limits<size_t>::max());
+    const auto markBad = [&badLine](size_t line) {
+        size_t current = badLine.load();
+        while (line < current && !badLine.compare_exchange_weak(current, line)) {
+        }
+    };
+
+    std::thread pipeThread([&]() {
+        parallelFor(pipeCount, MIN_CHUNK, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                const TextLine* rec = &lines[pipeStart + i * PIPE_LINES];
+                Pipe& pipe = newPipes[i];
+                pipe.name.assign(rec[1].begin, rec[1].end);
+                if (!parseField(rec[0], pipe.id) || !parseField(rec[2], pipe.length) ||
+                    !parseField(rec[3], pipe.diameter) || !parseField(rec[4], pipe.underRepair) ||
+                    !parseField(rec[5], pipe.inUse)) {
+                    markBad(pipeStart + i * PIPE_LINES);
+                }
+            }
+        });
+    });
+    std::thread stationThread([&]() {
+        parallelFor(stationCount, MIN_CHUNK, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                const TextLine* rec = &lines[stationStart + i * STATION_LINES];
+                CompressorStation& station = newStations[i];
+                station.name.assign(rec[1].begin, rec[1].end);
+                if (!parseField(rec[0], station.id) || !parseField(rec[2], station.totalWorkshops) ||
+                    !parseField(rec[3], station.workingWorkshops) || !parseField(rec[4], station.stationClass)) {
+                    markBad(stationStart + i * STATION_LINES);
+                }
+            }
+        });
+    });
+    parallelFor(connCount, MIN_CHUNK, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const TextLine* rec = &lines[connStart + i * CONNECTION_LINES];
+            NetworkConnection& conn = newConnections[i];
+            if (!parseField(rec[0], conn.pipeId) || !parseField(rec[1], conn.fromStationId) ||
+                !parseField(rec[2], conn.toStationId)) {
+                markBad(connStart + i * CONNECTION_LINES);
+            }
+        }
+    });
+    pipeThread.join();
+    stationThread.join();
+
+    if (badLine.load() != std::numeric_limits<size_t>::max()) {
+        error = "oshibka razbora zapisi na stroke " + std::to_string(badLine.load() + 1);
+        return false;
+    }
+
+    std::vector<std::pair<int, size_t>> pipeIndex(pipeCount), stationIndex(stationCount);
+    for (size_t i = 0; i < pipeCount; ++i) pipeIndex[i] = {newPipes[i].id, i};
+    for (size_t i = 0; i < stationCount; ++i) stationIndex[i] = {newStations[i].id, i};
+    std::sort(pipeIndex.begin(), pipeIndex.end());
+    std::sort(stationIndex.begin(), stationIndex.end());
+    const auto hasDuplicate = [](const std::vector<std::pair<int, size_t>>& index) {
+        return std::adjacent_find(index.begin(), index.end(),
+                                  [](const auto& a, const auto& b) { return a.first == b.first; }) != index.end();
+    };
+    if (hasDuplicate(pipeIndex) || hasDuplicate(stationIndex)) {
+        error = "povtorjajushhiesja ID trub ili KS";
+        return false;
+    }
+    const auto lookup = [](const std::vector<std::pair<int, size_t>>& index, int id) {
+        auto it = std::lower_bound(index.begin(), index.end(), std::make_pair(id, size_t(0)));
+        return (it != index.end() && it->first == id) ? it->second : std::numeric_limits<size_t>::max();
+    };
+
+    std::vector<std::atomic<int>> pipeRefs(pipeCount);
+    std::atomic<size_t> badConnection(std::numeric_limits<size_t>::max());
+    parallelFor(connCount, MIN_CHUNK, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const NetworkConnection& conn = newConnections[i];
+            size_t pipeIdx = lookup(pipeIndex, conn.pipeId);
+            if (pipeIdx == std::numeric_limits<size_t>::max() ||
+                lookup(stationIndex, conn.fromStationId) == std::numeric_limits<size_t>::max() ||
+                lookup(stationIndex, conn.toStationId) == std::numeric_limits<size_t>::max() ||
+                conn.fromStationId == conn.toStationId) {
+                badConnection.store(i);
+                continue;
+            }
+            pipeRefs[pipeIdx].fetch_add(1);
+        }
+    });
+    if (badConnection.load() != std::numeric_limits<size_t>::max()) {
+        const NetworkConnection& conn = newConnections[badConnection.load()];
+        error = "soedinenie KS " + std::to_string(conn.fromStationId) + " -> KS " +
+                std::to_string(conn.toStationId) + " ssylaetsja na nesushhestvujushhij obekt";
+        return false;
+    }
+
+    std::atomic<size_t> badPipe(std::numeric_limits<size_t>::max());
+    parallelFor(pipeCount, MIN_CHUNK, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            int refs = pipeRefs[i].load();
+            if (refs > 1 || newPipes[i].inUse != (refs == 1)) {
+                badPipe.store(i);
+            }
+        }
+    });
+    if (badPipe.load() != std::numeric_limits<size_t>::max()) {
+        error = "nesoglasovannyj priznak ispolzovanija truby ID " + std::to_string(newPipes[badPipe.load()].id);
+        return false;
+    }
+
+    nextPipeId = newNextPipeId;
+    nextStationId = newNextStationId;
+    pipes.swap(newPipes);
+    stations.swap(newStations);
+    connections.swap(newConnections);
+    markAllChanged();
+    return true;
+}
+
+// Zhurnal izmenenij: kazhdaja mutacija dopisyvaetsja v <imja>.journal odnoj strokoj,
+// gruppa zapisej zakryvaetsja strokoj COMMIT. Pri vosstanovlenii beretsja snimok
+// <imja>.snap i primenjajutsja tolko zavershennye gruppy. Snimok i zhurnal nachinajutsja
+// strokoj GEN <n>: esli sboj sluchilsja mezhdu zamenoj snimka i ochistkoj zhurnala,
+// u zhurnala ostaetsja staroe pokolenie i on ne primenjaetsja povtorno.
+const int JOURNAL_GROUP_SIZE = 32;
+const std::chrono::milliseconds JOURNAL_GROUP_INTERVAL(1000);
+const int JOURNAL_COMPACT_THRESHOLD = 10000;
+
+std::string journalBaseName;
+std::FILE* journalFile = nullptr;
+std::string journalPending;
+int journalPendingRecords = 0;
+int journalRecordCount = 0;
+unsigned long long journalGeneration = 0;
+std::chrono::steady_clock::time_point journalGroupStarted;
+
+// Otkrytuju gruppu zakryvaet libo sledujushhaja mutacija, libo fonovyj potok
+// po istechenii JOURNAL_GROUP_INTERVAL. Fonovyj potok ne kompaktiruet zhurnal:
+// snimok chitaet globalnye dannye, kotorye menjaet tolko osnovnoj potok.
+std::mutex journalMutex;
+std::condition_variable journalWakeup;
+std::thread journalFlusher;
+bool journalFlusherStop = false;
+
+std::string pipeRecord(const Pipe& pipe) {
+    std::ostringstream record;
+    record << std::setprecision(std::numeric_limits<double>::max_digits10) << "P " << pipe.id << ' ' << pipe.length << ' '
+           << pipe.diameter << ' ' << pipe.underRepair << ' ' << pipe.inUse << ' ' << pipe.name;
+    return record.str();
+}
+
+std::string stationRecord(const CompressorStation& station) {
+    std::ostringstream record;
+    record << "S " << station.id << ' ' << station.totalWorkshops << ' '
+           << station.workingWorkshops << ' ' << station.stationClass << ' ' << station.name;
+    return record.str();
+}
+
+void syncFile(std::FILE* file) {
+    std::fflush(file);
+#ifdef _WIN32
+    _commit(_fileno(file));
+#else
+    fsync(fileno(file));
+#endif
+}
+
+// Indeksy obektov po ID na vremja vosstanovlenija zhurnala: kazhdaja zapis nahodit
+// svoj obekt bez linejnogo poiska. Posle udalenija pereschityvaetsja tolko
+// sdvinutyj hvost.
+struct JournalReplayIndex {
+    std::unordered_map<int, size_t> pipeAt;
+    std::unordered_map<int, size_t> stationAt;
+    std::map<std::pair<int, int>, size_t> connectionAt;
+};
+
+void reindexPipes(JournalReplayIndex& index, size_t from) {
+    for (size_t i = from; i < pipes.size(); ++i) {
+        index.pipeAt[pipes[i].id] = i;
+    }
+}
+
+void reindexStations(JournalReplayIndex& index, size_t from) {
+    for (size_t i = from; i < stations.size(); ++i) {
+        index.stationAt[stations[i].id] = i;
+    }
+}
+
+void reindexConnections(JournalReplayIndex& index, size_t from) {
+    for (size_t i = from; i < connections.size(); ++i) {
+        index.connectionAt[{connections[i].fromStationId, connections[i].toStationId}] = i;
+    }
+}
+
+JournalReplayIndex buildReplayIndex() {
+    JournalReplayIndex index;
+    index.pipeAt.reserve(pipes.size());
+    index.stationAt.reserve(stations.size());
+    reindexPipes(index, 0);
+    reindexStations(index, 0);
+    reindexConnections(index, 0);
+    return index;
+}
+
+void setPipeInUse(JournalReplayIndex& index, int pipeId, bool inUse) {
+    auto it = index.pipeAt.find(pipeId);
+    if (it != index.pipeAt.end()) {
+        pipes[it->second].inUse = inUse;
+        markChanged(changedPipeChunks, pipes, pipes[it->second]);
+    }
+}
+
+bool applyJournalRecord(const std::string& record, JournalReplayIndex& index) {
+    std::istringstream input(record);
+    std::string type;
+    input >> type;
+
+    if (type == "P" || type == "IP") {
+        size_t position = pipes.size();
+        if (type == "IP" && !(input >> position)) {
+            return false;
+        }
+        Pipe pipe;
+        if (!(input >> pipe.id >> pipe.length >> pipe.diameter >> pipe.underRepair >> pipe.inUse)) {
+            return false;
+        }
+        input.get();
+        std::getline(input, pipe.name);
+        auto it = index.pipeAt.find(pipe.id);
+        if (it != index.pipeAt.end()) {
+            pipes[it->second] = pipe;
+            markChanged(changedPipeChunks, pipes, pipes[it->second]);
+        } else {
+            position = std::min(position, pipes.size());
+            markShifted(changedPipeChunks, position);
+            pipes.insert(pipes.begin() + position, pipe);
+            reindexPipes(index, position);
+        }
+        nextPipeId = std::max(nextPipeId, pipe.id + 1);
+    } else if (type == "S" || type == "IS") {
+        size_t position = stations.size();
+        if (type == "IS" && !(input >> position)) {
+            return false;
+        }
+        CompressorStation station;
+        if (!(input >> station.id >> station.totalWorkshops >> station.workingWorkshops >> station.stationClass)) {
+            return false;
+        }
+        input.get();
+        std::getline(input, station.name);
+        auto it = index.stationAt.find(station.id);
+        if (it != index.stationAt.end()) {
+            stations[it->second] = station;
+            markChanged(changedStationChunks, stations, stations[it->second]);
+        } else {
+            position = std::min(position, stations.size());
+            markShifted(changedStationChunks, position);
+            stations.insert(stations.begin() + position, station);
+            reindexStations(index, position);
+        }
+        nextStationId = std::max(nextStationId, station.id + 1);
+    } else if (type == "XP") {
+        int id;
+        if (!(input >> id)) return false;
+        auto it = index.pipeAt.find(id);
+        if (it != index.pipeAt.end()) {
+            size_t position = it->second;
+            index.pipeAt.erase(it);
+            markShifted(changedPipeChunks, position);
+            pipes.erase(pipes.begin() + position);
+            reindexPipes(index, position);
+        }
+    } else if (type == "XS") {
+        int id;
+        if (!(input >> id)) return false;
+        auto it = index.stationAt.find(id);
+        if (it != index.stationAt.end()) {
+            size_t position = it->second;
+            index.stationAt.erase(it);
+            markShifted(changedStationChunks, position);
+            stations.erase(stations.begin() + position);
+            reindexStations(index, position);
+        }
+    } else if (type == "C" || type == "IC") {
+        size_t position = connections.size();
+        if (type == "IC" && !(input >> position)) {
+            return false;
+        }
+        NetworkConnection conn;
+        if (!(input >> conn.pipeId >> conn.fromStationId >> conn.toStationId)) {
+            return false;
+        }
+        if (index.connectionAt.count({conn.fromStationId, conn.toStationId})) {
+            return true;
+        }
+        setPipeInUse(index, conn.pipeId, true);
+        position = std::min(position, connections.size());
+        markShifted(changedConnectionChunks, position);
+        connections.insert(connections.begin() + position, conn);
+        reindexConnections(index, position);
+    } else if (type == "D") {
+        int fromId, toId;
+        if (!(input >> fromId >> toId)) return false;
+        auto it = index.connectionAt.find({fromId, toId});
+        if (it != index.connectionAt.end()) {
+            size_t position = it->second;
+            index.connectionAt.erase(it);
+            setPipeInUse(index, connections[position].pipeId, false);
+            markShifted(changedConnectionChunks, position);
+            connections.erase(connections.begin() + position);
+            reindexConnections(index, position);
+        }
+    } else if (type == "R") {
+        bool repair;
+        if (!(input >> repair)) return false;
+        int id;
+        while (input >> id) {
+            auto it = index.pipeAt.find(id);
+            if (it != index.pipeAt.end()) {
+                pipes[it->second].underRepair = repair;
+                markChanged(changedPipeChunks, pipes, pipes[it->second]);
+            }
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool compactJournalLocked() {
+    if (journalBaseName.empty()) {
+        return false;
+    }
+
+    const std::string snapName = journalBaseName + ".snap";
+    const std::string tmpName = snapName + ".tmp";
+    std::FILE* snap = std::fopen(tmpName.c_str(), "wb");
+    if (!snap) {
+        return false;
+    }
+    const unsigned long long generation = journalGeneration + 1;
+    std::ostringstream out;
+    out << "GEN " << generation << '\n';
+    writeNetwork(out);
+    const std::string data = out.str();
+    bool ok = std::fwrite(data.data(), 1, data.size(), snap) == data.size();
+    syncFile(snap);
+    std::fclose(snap);
+    if (!ok) {
+        std::remove(tmpName.c_str());
+        return false;
+    }
+#ifdef _WIN32
+    std::remove(snapName.c_str());
+#endif
+    if (std::rename(tmpName.c_str(), snapName.c_str()) != 0) {
+        return false;
+    }
+    journalGeneration = generation;
+
+    if (journalFile) {
+        std::fclose(journalFile);
+    }
+    journalFile = std::fopen((journalBaseName + ".journal").c_str(), "wb");
+    journalPending.clear();
+    journalPendingRecords = 0;
+    journalRecordCount = 0;
+    if (!journalFile) {
+        return false;
+    }
+    std::fprintf(journalFile, "GEN %llu\n", generation);
+    syncFile(journalFile);
+    return true;
+}
+
+bool compactJournal() {
+    std::lock_guard<std::mutex> lock(journalMutex);
+    return compactJournalLocked();
+}
+
+void writePendingGroupLocked() {
+    journalPending += "COMMIT\n";
+    std::fwrite(journalPending.data(), 1, journalPending.size(), journalFile);
+    syncFile(journalFile);
+    journalRecordCount += journalPendingRecords;
+    journalPending.clear();
+    journalPendingRecords = 0;
+}
+
+void journalCommit(bool force) {
+    std::lock_guard<std::mutex> lock(journalMutex);
+    if (!journalFile || journalPendingRecords == 0) {
+        return;
+    }
+    if (!force && journalPendingRecords < JOURNAL_GROUP_SIZE &&
+        std::chrono::steady_clock::now() - journalGroupStarted < JOURNAL_GROUP_INTERVAL) {
+        return;
+    }
+
+    writePendingGroupLocked();
+    if (journalRecordCount >= JOURNAL_COMPACT_THRESHOLD) {
+        compactJournalLocked();
+    }
+}
+
+void journalAppend(const std::string& record) {
+    std::lock_guard<std::mutex> lock(journalMutex);
+    if (!journalFile) {
+        return;
+    }
+    if (journalPendingRecords == 0) {
+        journalGroupStarted = std::chrono::steady_clock::now();
+        journalWakeup.notify_one();
+    }
+    journalPending += record;
+    journalPending += '\n';
+    journalPendingRecords++;
+}
+
+void journalFlusherLoop() {
+    std::unique_lock<std::mutex> lock(journalMutex);
+    while (!journalFlusherStop) {
+        if (journalPendingRecords == 0) {
+            journalWakeup.wait(lock);
+            continue;
+        }
+        auto deadline = journalGroupStarted + JOURNAL_GROUP_INTERVAL;
+        if (std::chrono::steady_clock::now() < deadline) {
+            journalWakeup.wait_until(lock, deadline);
+            continue;
+        }
+        if (journalFile) {
+            writePendingGroupLocked();
+        }
+    }
+}
+
+void closeJournal() {
+    {
+        std::lock_guard<std::mutex> lock(journalMutex);
+        if (!journalFile) {
+            return;
+        }
+        if (journalPendingRecords > 0) {
+            writePendingGroupLocked();
+        }
+        journalFlusherStop = true;
+    }
+    journalWakeup.notify_all();
+    if (journalFlusher.joinable()) {
+        journalFlusher.join();
+    }
+    std::fclose(journalFile);
+    journalFile = nullptr;
+    journalBaseName.clear();
+}
+
+bool openJournal(const std::string& baseName) {
+    closeJournal();
+
+    std::string snapData, error;
+    unsigned long long snapGeneration = 0;
+    bool haveSnap = readFileBlock(baseName + ".snap", snapData);
+    if (haveSnap && snapData.compare(0, 4, "GEN ") == 0) {
+        snapGeneration = std::strtoull(snapData.c_str() + 4, nullptr, 10);
+        snapData.erase(0, snapData.find('\n') + 1);
+    }
+    if (haveSnap && !parseNetwork(snapData, error)) {
+        return false;
+    }
+    journalGeneration = snapGeneration;
+
+    int replayed = 0;
+    bool tornTail = false;
+    bool staleJournal = false;
+    std::ifstream journal(baseName + ".journal", std::ios::binary);
+    if (journal.is_open()) {
+        JournalReplayIndex index = buildReplayIndex();
+        std::vector<std::string> group;
+        std::string line;
+        if (journal.peek() == 'G' && std::getline(journal, line)) {
+            staleJournal = std::strtoull(line.c_str() + 4, nullptr, 10) < snapGeneration;
+        }
+        while (!staleJournal && std::getline(journal, line)) {
+            if (journal.eof()) {
+                tornTail = true;
+                break;
+            }
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (line == "COMMIT") {
+                for (const auto& record : group) {
+                    applyJournalRecord(record, index);
+                }
+                replayed += group.size();
+                group.clear();
+            } else {
+                group.push_back(line);
+            }
+        }
+        tornTail = tornTail || !group.empty();
+    }
+
+    journalBaseName = baseName;
+    if (!haveSnap || tornTail || staleJournal || replayed >= JOURNAL_COMPACT_THRESHOLD) {
+        if (!compactJournal()) {
+            journalBaseName.clear();
+            return false;
+        }
+    } else {
+        journalFile = std::fopen((baseName + ".journal").c_str(), "ab");
+        if (!journalFile) {
+            journalBaseName.clear();
+            return false;
+        }
+        journalRecordCount = replayed;
+    }
+
+    journalFlusherStop = false;
+    journalFlusher = std::thread(journalFlusherLoop);
+
+    static bool exitHandlerRegistered = false;
+    if (!exitHandlerRegistered) {
+        std::atexit(closeJournal);
+        exitHandlerRegistered = true;
+    }
+    return true;
+}
+
+bool operator==(const Pipe& a, const Pipe& b) {
+    return a.id == b.id && a.name == b.name && a.length == b.length && a.diameter == b.diameter &&
+           a.underRepair == b.underRepair && a.inUse == b.inUse;
+}
+
+bool operator==(const CompressorStation& a, const CompressorStation& b) {
+    return a.id == b.id && a.name == b.name && a.totalWorkshops == b.totalWorkshops &&
+           a.workingWorkshops == b.workingWorkshops && a.stationClass == b.stationClass;
+}
+
+bool operator==(const NetworkConnection& a, const NetworkConnection& b) {
+    return a.pipeId == b.pipeId && a.fromStationId == b.fromStationId && a.toStationId == b.toStationId;
+}
+
+// Versija seti hranit obekty blokami po VERSION_CHUNK_SIZE. Neizmenivshiesja bloki
+// razdeljajutsja s predydushhej versiej, poetomu novaja versija zanimaet pamjat
+// proporcionalno izmeneniju. Versii neizmenjaemy i mogut chitatsja iz drugih potokov.
+const size_t MAX_VERSION_HISTORY = 256;
+
+template <typename T>
+using VersionChunks = std::vector<std::shared_ptr<const std::vector<T>>>;
+
+struct NetworkVersion {
+    std::string label;
+    int nextPipeId = 1;
+    int nextStationId = 1;
+    VersionChunks<Pipe> pipes;
+    VersionChunks<CompressorStation> stations;
+    VersionChunks<NetworkConnection> connections;
+};
+
+std::vector<std::shared_ptr<const NetworkVersion>> versionHistory = {std::make_shared<NetworkVersion>()};
+size_t versionCursor = 0;
+std::map<std::string, std::shared_ptr<const NetworkVersion>> checkpoints;
+
+// Kopiruet tolko otmechennye bloki, ostalnye berutsja iz predydushhej versii.
+template <typename T>
+VersionChunks<T> shareChunks(const std::vector<T>& items, const VersionChunks<T>& previous,
+                             ChangedChunks& changed) {
+    VersionChunks<T> chunks = previous;
+    chunks.resize((items.size() + VERSION_CHUNK_SIZE - 1) / VERSION_CHUNK_SIZE);
+    const auto copyChunk = [&](size_t index) {
+        auto first = items.begin() + index * VERSION_CHUNK_SIZE;
+        auto last = items.begin() + std::min(items.size(), (index + 1) * VERSION_CHUNK_SIZE);
+        chunks[index] = std::make_shared<const std::vector<T>>(first, last);
+    };
+    const size_t copyFrom = std::min(changed.shiftedFrom, previous.size());
+    for (size_t index : changed.chunks) {
+        if (index >= copyFrom || index >= chunks.size()) {
+            break;
+        }
+        copyChunk(index);
+    }
+    for (size_t index = copyFrom; index < chunks.size(); ++index) {
+        copyChunk(index);
+    }
+    changed = ChangedChunks();
+    return chunks;
+}
+
+// Privodit items ot versii current k versii target, perepisyvaja tolko otlichajushhiesja bloki.
+template <typename T>
+void restoreChunks(std::vector<T>& items, const VersionChunks<T>& current, const VersionChunks<T>& target) {
+    size_t size = 0;
+    for (const auto& chunk : target) {
+        size += chunk->size();
+    }
+    items.resize(size);
+    for (size_t index = 0; index < target.size(); ++index) {
+        if (index < current.size() && current[index] == target[index]) {
+            continue;
+        }
+        std::copy(target[index]->begin(), target[index]->end(), items.begin() + index * VERSION_CHUNK_SIZE);
+    }
+}
+
+// Obekty iz blokov, kotorye ne razdeljajutsja mezhdu dvumja versijami; dlja obektov
+// versii target zapominaetsja ih pozicija. Udalenie ili vstavka sdvigaet ves hvost,
+// no porjadok ostavshihsja obektov ne menjaetsja, poetomu sovpadajushhie nachalo i
+// konec posledovatelnostej otbrasyvajutsja i ostaetsja tolko samo izmenenie.
+template <typename T>
+void differingItems(const VersionChunks<T>& current, const VersionChunks<T>& target,
+                    std::vector<T>& removed, std::vector<std::pair<size_t, T>>& added) {
+    for (size_t index = 0; index < std::max(current.size(), target.size()); ++index) {
+        if (index < current.size() && index < target.size() && current[index] == target[index]) {
+            continue;
+        }
+        if (index < current.size()) {
+            removed.insert(removed.end(), current[index]->begin(), current[index]->end());
+        }
+        if (index < target.size()) {
+            for (size_t offset = 0; offset < target[index]->size(); ++offset) {
+                added.push_back({index * VERSION_CHUNK_SIZE + offset, (*target[index])[offset]});
+            }
+        }
+    }
+
+    size_t prefix = 0;
+    while (prefix < removed.size() && prefix < added.size() && removed[prefix] == added[prefix].second) {
+        ++prefix;
+    }
+    size_t suffix = 0;
+    while (suffix < removed.size() - prefix && suffix < added.size() - prefix &&
+           removed[removed.size() - 1 - suffix] == added[added.size() - 1 - suffix].second) {
+        ++suffix;
+    }
+    removed.erase(removed.end() - suffix, removed.end());
+    removed.erase(removed.begin(), removed.begin() + prefix);
+    added.erase(added.end() - suffix, added.end());
+    added.erase(added.begin(), added.begin() + prefix);
+}
+
+// Zapis vstavki na poziciju: "P 5 ..." prevrashhaetsja v "IP <pozicija> 5 ...".
+std::string insertRecord(const std::string& record, size_t position) {
+    size_t typeEnd = record.find(' ');
+    return "I" + record.substr(0, typeEnd) + " " + std::to_string(position) + record.substr(typeEnd);
+}
+
+// Zapisyvaet v zhurnal obekty odnogo vida: udalenija, zatem vstavki po vozrastaniju
+// pozicii i, nakonec, izmenenija ostavshihsja obektov.
+template <typename T, typename Record>
+void journalItemChanges(const std::vector<T>& removed, const std::vector<std::pair<size_t, T>>& added,
+                        const std::string& removeType, Record record) {
+    std::unordered_map<int, const T*> removedById;
+    for (const auto& item : removed) {
+        removedById[item.id] = &item;
+    }
+    std::unordered_set<int> addedIds;
+    for (const auto& entry : added) {
+        addedIds.insert(entry.second.id);
+    }
+    for (const auto& item : removed) {
+        if (!addedIds.count(item.id)) {
+            journalAppend(removeType + " " + std::to_string(item.id));
+        }
+    }
+    for (const auto& [position, item] : added) {
+        if (!removedById.count(item.id)) {
+            journalAppend(insertRecord(record(item), position));
+        }
+    }
+    for (const auto& entry : added) {
+        auto it = removedById.find(entry.second.id);
+        if (it != removedById.end() && !(*it->second == entry.second)) {
+            journalAppend(record(entry.second));
+        }
+    }
+}
+
+// Zapisyvaet v zhurnal perehod mezhdu versijami obychnymi zapisjami. Obshhie bloki
+// propuskajutsja, poetomu razmer zapisi proporcionalen izmeneniju. Vosstanovlennye
+// obekty vstavljajutsja na prezhnie pozicii, chtoby porjadok posle vosstanovlenija
+// zhurnala sovpadal s porjadkom v pamjati.
+void journalVersionChange(const NetworkVersion& current, const NetworkVersion& target) {
+    using ConnectionKey = std::tuple<int, int, int>;
+    const auto key = [](const NetworkConnection& conn) {
+        return ConnectionKey(conn.pipeId, conn.fromStationId, conn.toStationId);
+    };
+    std::vector<NetworkConnection> oldConnections;
+    std::vector<std::pair<size_t, NetworkConnection>> newConnections;
+    differingItems(current.connections, target.connections, oldConnections, newConnections);
+    std::set<ConnectionKey> oldKeys, newKeys;
+    for (const auto& conn : oldConnections) {
+        oldKeys.insert(key(conn));
+    }
+    for (const auto& entry : newConnections) {
+        newKeys.insert(key(entry.second));
+    }
+    for (const auto& conn : oldConnections) {
+        if (!newKeys.count(key(conn))) {
+            journalAppend("D " + std::to_string(conn.fromStationId) + " " + std::to_string(conn.toStationId));
+        }
+    }
+    for (const auto& [position, conn] : newConnections) {
+        if (!oldKeys.count(key(conn))) {
+            journalAppend("IC " + std::to_string(position) + " " + std::to_string(conn.pipeId) + " " +
+                          std::to_string(conn.fromStationId) + " " + std::to_string(conn.toStationId));
+        }
+    }
+
+    std::vector<Pipe> oldPipes;
+    std::vector<std::pair<size_t, Pipe>> newPipes;
+    differingItems(current.pipes, target.pipes, oldPipes, newPipes);
+    journalItemChanges(oldPipes, newPipes, "XP", pipeRecord);
+
+    std::vector<CompressorStation> oldStations;
+    std::vector<std::pair<size_t, CompressorStation>> newStations;
+    differingItems(current.stations, target.stations, oldStations, newStations);
+    journalItemChanges(oldStations, newStations, "XS", stationRecord);
+}
+
+std::shared_ptr<const NetworkVersion> captureVersion(const std::string& label) {
+    const NetworkVersion& previous = *versionHistory[versionCursor];
+    auto version = std::make_shared<NetworkVersion>();
+    version->label = label;
+    version->nextPipeId = nextPipeId;
+    version->nextStationId = nextStationId;
+    version->pipes = shareChunks(pipes, previous.pipes, changedPipeChunks);
+    version->stations = shareChunks(stations, previous.stations, changedStationChunks);
+    version->connections = shareChunks(connections, previous.connections, changedConnectionChunks);
+    return version;
+}
+
+std::shared_ptr<const NetworkVersion> currentVersion() {
+    return versionHistory[versionCursor];
+}
+
+// Perevodit set iz versii current (tekushhee sostojanie) v versiju target.
+void restoreVersion(const NetworkVersion& current, const NetworkVersion& target) {
+    nextPipeId = target.nextPipeId;
+    nextStationId = target.nextStationId;
+    restoreChunks(pipes, current.pipes, target.pipes);
+    restoreChunks(stations, current.stations, target.stations);
+    restoreChunks(connections, current.connections, target.connections);
+    publishSnapshot();
+    if (journalFile) {
+        journalVersionChange(current, target);
+        journalCommit(false);
+    }
+}
+
+void pushVersion(std::shared_ptr<const NetworkVersion> version) {
+    versionHistory.resize(versionCursor + 1);
+    versionHistory.push_back(version);
+    if (versionHistory.size() > MAX_VERSION_HISTORY) {
+        versionHistory.erase(versionHistory.begin());
+    }
+    versionCursor = versionHistory.size() - 1;
+}
+
+// Vyzyvaetsja posle kazhdoj mutacii seti.
+void networkChanged(const std::string& label) {
+    journalCommit(false);
+    publishSnapshot();
+    pushVersion(captureVersion(label));
+}
+
+bool undoChange() {
+    if (versionCursor == 0) {
+        return false;
+    }
+    versionCursor--;
+    restoreVersion(*versionHistory[versionCursor + 1], *versionHistory[versionCursor]);
+    return true;
+}
+
+bool redoChange() {
+    if (versionCursor + 1 >= versionHistory.size()) {
+        return false;
+    }
+    versionCursor++;
+    restoreVersion(*versionHistory[versionCursor - 1], *versionHistory[versionCursor]);
+    return true;
+}
+
+void versionMenu() {
+    std::cout << "1. Otmenit" << std::endl;
+    std::cout << "2. Povtorit" << std::endl;
+    std::cout << "3. Sozdat kontrolnuju tochku" << std::endl;
+    std::cout << "4. Vernutsja k kontrolnoj tochke" << std::endl;
+    std::cout << "5. Istorija izmenenij" << std::endl;
+    std::cout << "Vyberite dejstvie: ";
+    int choice;
+    while (!(std::cin >> choice) || choice < 1 || choice > 5) {
+        std::cout << "Nevernyj vvod. Vvedite chislo ot 1 do 5: ";
+        clearInputBuffer();
+    }
+    clearInputBuffer();
+
+    if (choice == 1) {
+        if (undoChange()) {
+            logAction("Otmena izmenenija");
+            std::cout << "Izmenenie otmeneno." << std::endl;
+        } else {
+            std::cout << "Nechego otmenjat." << std::endl;
+        }
+    } else if (choice == 2) {
+        if (redoChange()) {
+            logAction("Povtor izmenenija");
+            std::cout << "Izmenenie povtoreno." << std::endl;
+        } else {
+            std::cout << "Nechego povtorjat." << std::endl;
+        }
+    } else if (choice == 3) {
+        std::cout << "Vvedite imja kontrolnoj tochki: ";
+        std::string name;
+        std::getline(std::cin, name);
+        checkpoints[name] = currentVersion();
+        logAction("Kontrolnaja tochka: " + name);
+        std::cout << "Kontrolnaja tochka sozdana: " << name << std::endl;
+    } else if (choice == 4) {
+        std::cout << "Vvedite imja kontrolnoj tochki: ";
+        std::string name;
+        std::getline(std::cin, name);
+        auto it = checkpoints.find(name);
+        if (it == checkpoints.end()) {
+            std::cout << "Kontrolnaja tochka " << name << " ne najdena." << std::endl;
+            return;
+        }
+        restoreVersion(*currentVersion(), *it->second);
+        auto version = std::make_shared<NetworkVersion>(*it->second);
+        version->label = "Vozvrat k kontrolnoj tochke: " + name;
+        pushVersion(version);
+        logAction("Vozvrat k kontrolnoj tochke: " + name);
+        std::cout << "Set vosstanovlena iz kontrolnoj tochki: " << name << std::endl;
+    } else {
+        std::cout << "\n=== ISTORIJA IZMENENIJ ===" << std::endl;
+        for (size_t i = 0; i < versionHistory.size(); ++i) {
+            std::cout << (i == versionCursor ? "* " : "  ") << i << ". "
+                      << (versionHistory[i]->label.empty() ? "Ishodnoe sostojanie" : versionHistory[i]->label)
+                      << std::endl;
+        }
+    }
+}
+
+// Indeks dostizhimosti. Nenapravlennaja svjaznost hranitsja v sisteme neperesekajushhihsja
+// mnozhestv i popolnjaetsja pri soedinenii KS bez perestrojki. Dlja napravlennoj
+// dostizhimosti komponenty silnoj svjaznosti sortirujutsja topologicheski i
+// poluchajut intervalnye metki ostovnogo lesa: vlozhennost intervalov srazu daet
+// "da", bolshij topologicheskij nomer - srazu "net", ostalnoe proverjaetsja obhodom
+// s otsecheniem po topologicheskomu nomeru. Truby v remonte ne uchityvajutsja.
+// Indeks privjazan k versii seti; izmenenija, ne zatragivajushhie soedinenija,
+// perenosjat ego na novuju versiju, ostalnye privodjat k lenivoj perestrojke.
+struct ReachabilityIndex {
+    std::shared_ptr<const NetworkVersion> version;
+    NetworkGraph graph;
+    std::vector<int> componentParent;
+    bool graphCurrent = false;
+    bool directedValid = false;
+    std::vector<int> scc;
+    std::vector<int> topoRank;
+    std::vector<int> preOrder;
+    std::vector<int> postOrder;
+    std::vector<std::vector<int>> dagEdges;
+    std::vector<int> visitStamp;
+    int currentStamp = 0;
+};
+
+ReachabilityIndex reachIndex;
+
+int findComponent(int v) {
+    std::vector<int>& parent = reachIndex.componentParent;
+    while (parent[v] != v) {
+        parent[v] = parent[parent[v]];
+        v = parent[v];
+    }
+    return v;
+}
+
+void uniteComponents(int a, int b) {
+    a = findComponent(a);
+    b = findComponent(b);
+    if (a != b) {
+        reachIndex.componentParent[std::max(a, b)] = std::min(a, b);
+    }
+}
+
+void rebuildUndirectedIndex() {
+    reachIndex.version = currentVersion();
+    reachIndex.graph = buildNetworkGraph();
+    reachIndex.graphCurrent = true;
+    reachIndex.directedValid = false;
+    size_t n = reachIndex.graph.stationIds.size();
+    reachIndex.componentParent.resize(n);
+    for (size_t v = 0; v < n; ++v) {
+        reachIndex.componentParent[v] = static_cast<int>(v);
+    }
+    for (const auto& edge : reachIndex.graph.edges) {
+        if (usableEdge(edge)) {
+            uniteComponents(edge.from, edge.to);
+        }
+    }
+}
+
+void rebuildDirectedIndex() {
+    const NetworkGraph& graph = reachIndex.graph;
+    int n = static_cast<int>(graph.stationIds.size());
+
+    std::vector<int>& scc = reachIndex.scc;
+    scc.assign(n, -1);
+    std::vector<int> index(n, -1), low(n, 0);
+    std::vector<char> onStack(n, 0);
+    std::vector<int> sccStack;
+    std::vector<std::pair<int, size_t>> callStack;
+    int counter = 0, sccCount = 0;
+    for (int root = 0; root < n; ++root) {
+        if (index[root] != -1) {
+            continue;
+        }
+        callStack.push_back({root, 0});
+        index[root] = low[root] = counter++;
+        sccStack.push_back(root);
+        onStack[root] = 1;
+        while (!callStack.empty()) {
+            auto& [v, next] = callStack.back();
+            const std::vector<int>& out = graph.outEdges[v];
+            if (next < out.size()) {
+                const GraphEdge& edge = graph.edges[out[next++]];
+                if (!usableEdge(edge)) {
+                    continue;
+                }
+                int w = edge.to;
+                if (index[w] == -1) {
+                    index[w] = low[w] = counter++;
+                    sccStack.push_back(w);
+                    onStack[w] = 1;
+                    callStack.push_back({w, 0});
+                } else if (onStack[w]) {
+                    low[v] = std::min(low[v], index[w]);
+                }
+                continue;
+            }
+            int finished = v;
+            callStack.pop_back();
+            if (!callStack.empty()) {
+                int caller = callStack.back().first;
+                low[caller] = std::min(low[caller], low[finished]);
+            }
+            if (low[finished] == index[finished]) {
+                int w;
+                do {
+                    w = sccStack.back();
+                    sccStack.pop_back();
+                    onStack[w] = 0;
+                    scc[w] = sccCount;
+                } while (w != finished);
+                sccCount++;
+            }
+        }
+    }
+
+    // Tarjan vydaet komponenty v obratnom topologicheskom porjadke.
+    reachIndex.topoRank.resize(sccCount);
+    for (int c = 0; c < sccCount; ++c) {
+        reachIndex.topoRank[c] = sccCount - 1 - c;
+    }
+    reachIndex.dagEdges.assign(sccCount, std::vector<int>());
+    for (const auto& edge : graph.edges) {
+        if (usableEdge(edge) && scc[edge.from] != scc[edge.to]) {
+            reachIndex.dagEdges[scc[edge.from]].push_back(scc[edge.to]);
+        }
+    }
+
+    reachIndex.preOrder.assign(sccCount, -1);
+    reachIndex.postOrder.assign(sccCount, -1);
+    int clock = 0;
+    std::vector<std::pair<int, size_t>> dfs;
+    for (int root = sccCount - 1; root >= 0; --root) {
+        if (reachIndex.preOrder[root] != -1) {
+            continue;
+        }
+        reachIndex.preOrder[root] = clock++;
+        dfs.push_back({root, 0});
+        while (!dfs.empty()) {
+            auto& [c, next] = dfs.back();
+            if (next < reachIndex.dagEdges[c].size()) {
+                int child = reachIndex.dagEdges[c][next++];
+                if (reachIndex.preOrder[child] == -1) {
+                    reachIndex.preOrder[child] = clock++;
+                    dfs.push_back({child, 0});
+                }
+                continue;
+            }
+            reachIndex.postOrder[c] = clock++;
+            dfs.pop_back();
+        }
+    }
+
+    reachIndex.visitStamp.assign(sccCount, 0);
+    reachIndex.currentStamp = 0;
+    reachIndex.directedValid = true;
+}
+
+void ensureReachabilityIndex(bool directed) {
+    if (reachIndex.version != currentVersion()) {
+        rebuildUndirectedIndex();
+    }
+    if (directed && !reachIndex.directedValid) {
+        if (!reachIndex.graphCurrent) {
+            rebuildUndirectedIndex();
+        }
+        rebuildDirectedIndex();
+    }
+}
+
+// Vyzyvaetsja srazu posle networkChanged() dlja izmenenij, ne menjajushhih soedinenija.
+void reachabilityUnaffected() {
+    if (versionCursor > 0 && reachIndex.version == versionHistory[versionCursor - 1]) {
+        reachIndex.version = currentVersion();
+    }
+}
+
+// Vyzyvaetsja srazu posle networkChanged() dlja novyh soedinenij.
+void reachabilityConnected(const std::vector<std::pair<int, int>>& links) {
+    if (versionCursor == 0 || reachIndex.version != versionHistory[versionCursor - 1]) {
+        return;
+    }
+    for (const auto& [fromId, toId] : links) {
+        int from = reachIndex.graph.indexOf(fromId);
+        int to = reachIndex.graph.indexOf(toId);
+        if (from < 0 || to < 0) {
+            return;
+        }
+        uniteComponents(from, to);
+    }
+    reachIndex.graphCurrent = false;
+    reachIndex.directedValid = false;
+    reachIndex.version = currentVersion();
+}
+
+bool stationsConnected(int fromId, int toId) {
+    ensureReachabilityIndex(false);
+    int from = reachIndex.graph.indexOf(fromId);
+    int to = reachIndex.graph.indexOf(toId);
+    if (from < 0 || to < 0) {
+        return fromId == toId;
+    }
+    return findComponent(from) == findComponent(to);
+}
+
+bool stationReachable(int fromId, int toId) {
+    if (fromId == toId) {
+        return true;
+    }
+    if (!stationsConnected(fromId, toId)) {
+        return false;
+    }
+    ensureReachabilityIndex(true);
+    int a = reachIndex.scc[reachIndex.graph.indexOf(fromId)];
+    int b = reachIndex.scc[reachIndex.graph.indexOf(toId)];
+
+    const auto contains = [](int outer, int inner) {
+        return reachIndex.preOrder[outer] <= reachIndex.preOrder[inner] &&
+               reachIndex.postOrder[inner] <= reachIndex.postOrder[outer];
+    };
+    if (a == b || contains(a, b)) {
+        return true;
+    }
+    if (reachIndex.topoRank[a] > reachIndex.topoRank[b]) {
+        return false;
+    }
+
+    int stamp = ++reachIndex.currentStamp;
+    std::vector<int> pending = {a};
+    reachIndex.visitStamp[a] = stamp;
+    while (!pending.empty()) {
+        int c = pending.back();
+        pending.pop_back();
+        for (int next : reachIndex.dagEdges[c]) {
+            if (next == b || contains(next, b)) {
+                return true;
+            }
+            if (reachIndex.visitStamp[next] != stamp &&
+                reachIndex.topoRank[next] < reachIndex.topoRank[b]) {
+                reachIndex.visitStamp[next] = stamp;
+                pending.push_back(next);
+            }
+        }
+    }
+    return false;
+}
+
+void journalMenu() {
+    std::cout << "Vvedite imja zhurnala (bez rasshirenija): ";
+    std::string baseName;
+    std::getline(std::cin, baseName);
+
+    if (openJournal(baseName)) {
+        networkChanged("Otkryt zhurnal: " + baseName);
+        logAction("Otkryt zhurnal: " + baseName);
+        std::cout << "Zhurnal otkryt: " << baseName << ". Trub: " << pipes.size()
+                  << ", KS: " << stations.size() << ", soedinenij: " << connections.size() << std::endl;
+    } else {
+        std::cout << "Oshibka otkrytija zhurnala!" << std::endl;
+    }
+}
+
+void addPipe() {
+    Pipe newPipe;
+    newPipe.id = nextPipeId++;
+    
+    std::cout << "Vvedite nazvanie truby: ";
+    std::getline(std::cin, newPipe.name);
+    
+    std::cout << "Vvedite dlinu truby (km): ";
+    while (!(std::cin >> newPipe.length) || newPipe.length <= 0) {
+        std::cout << "Nevernyj vvod. Vvedite polozhitelnoe chislo: ";
+        clearInputBuffer();
+    }
+    
+    std::cout << "Vvedite diametr truby (mm): ";
+    std::cout << "Dostupnye diametry: 500, 700, 1000, 1400" << std::endl;
+    while (!(std::cin >> newPipe.diameter) || 
+           (newPipe.diameter != 500 && newPipe.diameter != 700 && 
+            newPipe.diameter != 1000 && newPipe.diameter != 1400)) {
+        std::cout << "Nevernyj vvod. Vvedite odin iz dostupnyh diametrov (500, 700, 1000, 1400): ";
+        clearInputBuffer();
+    }
+    
+    newPipe.underRepair = false;
+    newPipe.inUse = false;
+    clearInputBuffer();
+    
+    pipes.push_back(newPipe);
+    markChanged(changedPipeChunks, pipes, pipes.back());
+    journalAppend(pipeRecord(newPipe));
+    networkChanged("Dobavlena truba ID: " + std::to_string(newPipe.id));
+    reachabilityUnaffected();
+    logAction("Dobavlena truba ID: " + std::to_string(newPipe.id));
+    std::cout << "Truba uspeshno dobavlena! ID: " << newPipe.id << std::endl;
+}
+
+void addCompressorStation() {
+    CompressorStation newStation;
+    newStation.id = nextStationId++;
+    
+    std::cout << "Vvedite nazvanie kompressornoj stancii: ";
+    std::getline(std::cin, newStation.name);
+    
+    std::cout << "Vvedite obshhee kolichestvo cehov: ";
+    while (!(std::cin >> newStation.totalWorkshops) || newStation.totalWorkshops <= 0) {
+        std::cout << "Nevernyj vvod. Vvedite polozhitelnoe celoe chislo: ";
+        clearInputBuffer();
+    }
+    
+    std::cout << "Vvedite kolichestvo rabotayushhih cehov: ";
+    while (!(std::cin >> newStation.workingWorkshops) || newStation.workingWorkshops < 0 || newStation.workingWorkshops > newStation.totalWorkshops) {
+        std::cout << "Nevernyj vvod. Vvedite chislo ot 0 do " << newStation.totalWorkshops << ": ";
+        clearInputBuffer();
+    }
+    
+    std::cout << "Vvedite klass stancii: ";
+    while (!(std::cin >> newStation.stationClass) || newStation.stationClass <= 0) {
+        std::cout << "Nevernyj vvod. Vvedite polozhitelnoe celoe chislo: ";
+        clearInputBuffer();
+    }
+    clearInputBuffer();
+    
+    stations.push_back(newStation);
+    markChanged(changedStationChunks, stations, stations.back());
+    journalAppend(stationRecord(newStation));
+    networkChanged("Dobavlena KS ID: " + std::to_string(newStation.id));
+    reachabilityUnaffected();
+    logAction("Dobavlena KS ID: " + std::to_string(newStation.id));
+    std::cout << "Kompressornaja stancija uspeshno dobavlena! ID: " << newStation.id << std::endl;
+}
+
+enum class OutputFormat { Text, Csv, JsonLines };
+
+enum class ObjectSection { All, Pipes, Stations };
+
+const std::streamoff OUTPUT_CHUNK_SIZE = 1 << 20;
+
+// Vyvod nakaplivaetsja v bufere i otpravljaetsja v std::cout krupnymi blokami,
+// bez sbrosa potoka na kazhdoj stroke.
+void flushOutputChunk(std::ostringstream& out, bool force) {
+    if (force || out.tellp() >= OUTPUT_CHUNK_SIZE) {
+        const std::string chunk = out.str();
+        std::cout.write(chunk.data(), chunk.size());
+        out.str("");
+        if (force) {
+            std::cout.flush();
+        }
+    }
+}
+
+std::string csvField(const std::string& value) {
+    if (value.find_first_of(",\"\r\n") == std::string::npos) {
+        return value;
+    }
+    std::string quoted = "\"";
+    for (char c : value) {
+        if (c == '"') quoted += '"';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+std::string jsonString(const std::string& value) {
+    std::string escaped = "\"";
+    for (char c : value) {
+        switch (c) {
+            case '"': escaped += "\\\""; break;
+            case '\\': escaped += "\\\\"; break;
+            case '\n': escaped += "\\n"; break;
+            case '\r': escaped += "\\r"; break;
+            case '\t': escaped += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    const char* hex = "0123456789abcdef";
+                    escaped += "\\u00";
+                    escaped += hex[(c >> 4) & 0xF];
+                    escaped += hex[c & 0xF];
+                } else {
+                    escaped += c;
+                }
+        }
+    }
+    return escaped + "\"";
+}
+
+void pageBounds(size_t total, size_t offset, size_t limit, size_t& begin, size_t& end) {
+    begin = std::min(offset, total);
+    end = (limit == 0) ? total : std::min(total, begin + limit);
+}
+
+// Vybrannye razdely obrazujut odnu posledovatelnost (snachala truby, zatem KS),
+// smeshhenie i limit otschityvajutsja v nej. CSV vyvoditsja dlja odnogo razdela,
+// chtoby u tablicy byl odin zagolovok.
+void displayAllObjects(size_t offset = 0, size_t limit = 0,
+                       OutputFormat format = OutputFormat::Text,
+                       ObjectSection section = ObjectSection::All) {
+    std::ostringstream out;
+    if (format != OutputFormat::Text) {
+        out << std::setprecision(std::numeric_limits<double>::max_digits10);
+    }
+    const size_t pipeCount = (section != ObjectSection::Stations) ? pipes.size() : 0;
+    const size_t stationCount = (section != ObjectSection::Pipes) ? stations.size() : 0;
+    size_t begin, end;
+    pageBounds(pipeCount + stationCount, offset, limit, begin, end);
+
+    if (section != ObjectSection::Stations) {
+        if (format == OutputFormat::Text) {
+            out << "\n=== TRUBY ===\n";
+            if (pipes.empty()) {
+                out << "Net trub.\n";
+            }
+        } else if (format == OutputFormat::Csv) {
+            out << "id,nazvanie,dlina,diametr,v_remonte,v_ispolzovanii,proizvoditelnost\n";
+        }
+    }
+    for (size_t i = begin; i < std::min(end, pipeCount); ++i) {
+        const Pipe& pipe = pipes[i];
+        if (format == OutputFormat::Text) {
+            out << "ID: " << pipe.id << ", Nazvanie: " << pipe.name
+                << ", Dlina: " << pipe.length << " km"
+                << ", Diametr: " << pipe.diameter << " mm"
+                << ", V remonte: " << (pipe.underRepair ? "Da" : "Net")
+                << ", V ispolzovanii: " << (pipe.inUse ? "Da" : "Net")
+                << ", Proizvoditelnost: " << pipe.getCapacity() << " ed.\n";
+        } else if (format == OutputFormat::Csv) {
+            out << pipe.id << ',' << csvField(pipe.name) << ',' << pipe.length << ','
+                << pipe.diameter << ',' << pipe.underRepair << ',' << pipe.inUse << ','
+                << pipe.getCapacity() << '\n';
+        } else {
+            out << "{\"type\":\"pipe\",\"id\":" << pipe.id
+                << ",\"name\":" << jsonString(pipe.name)
+                << ",\"length\":" << pipe.length
+                << ",\"diameter\":" << pipe.diameter
+                << ",\"underRepair\":" << (pipe.underRepair ? "true" : "false")
+                << ",\"inUse\":" << (pipe.inUse ? "true" : "false")
+                << ",\"capacity\":" << pipe.getCapacity() << "}\n";
+        }
+        flushOutputChunk(out, false);
+    }
+
+    if (section != ObjectSection::Pipes) {
+        if (format == OutputFormat::Text) {
+            out << "\n=== KOMPRESSORNYE STANCII ===\n";
+            if (stations.empty()) {
+                out << "Net kompressornyh stancij.\n";
+            }
+        } else if (format == OutputFormat::Csv) {
+            out << "id,nazvanie,vsego_cehov,rabotajushhih_cehov,neispolzovano_procent,klass\n";
+        }
+    }
+    for (size_t i = std::max(begin, pipeCount); i < end; ++i) {
+        const CompressorStation& station = stations[i - pipeCount];
+        double percent = (station.totalWorkshops - station.workingWorkshops) * 100.0 / station.totalWorkshops;
+        if (format == OutputFormat::Text) {
+            out << "ID: " << station.id << ", Nazvanie: " << station.name
+                << ", Ceha: " << station.workingWorkshops << "/" << station.totalWorkshops
+                << ", Neispolzovano: " << percent << "%"
+                << ", Klass: " << station.stationClass << '\n';
+        } else if (format == OutputFormat::Csv) {
+            out << station.id << ',' << csvField(station.name) << ','
+                << station.totalWorkshops << ',' << station.workingWorkshops << ','
+                << percent << ',' << station.stationClass << '\n';
+        } else {
+            out << "{\"type\":\"station\",\"id\":" << station.id
+                << ",\"name\":" << jsonString(station.name)
+                << ",\"totalWorkshops\":" << station.totalWorkshops
+                << ",\"workingWorkshops\":" << station.workingWorkshops
+                << ",\"idlePercent\":" << percent
+                << ",\"class\":" << station.stationClass << "}\n";
+        }
+        flushOutputChunk(out, false);
+    }
+
+    flushOutputChunk(out, true);
+}
+
+void displayNetwork(size_t offset = 0, size_t limit = 0,
+                    OutputFormat format = OutputFormat::Text) {
+    std::ostringstream out;
+    size_t begin, end;
+    pageBounds(connections.size(), offset, limit, begin, end);
+
+    if (format == OutputFormat::Text) {
+        out << "\n=== GASOTRANSPORTNAYA SET ===\n";
+        if (connections.empty()) {
+            out << "Set pusta.\n";
+        }
+    } else if (format == OutputFormat::Csv) {
+        out << "ks_vhoda,ks_vyhoda,truba_id\n";
+    }
+    for (size_t i = begin; i < end; ++i) {
+        const NetworkConnection& conn = connections[i];
+        if (format == OutputFormat::Text) {
+            out << "KS " << conn.fromStationId << " -> KS " << conn.toStationId
+                << " (Truba ID: " << conn.pipeId << ")\n";
+        } else if (format == OutputFormat::Csv) {
+            out << conn.fromStationId << ',' << conn.toStationId << ',' << conn.pipeId << '\n';
+        } else {
+            out << "{\"type\":\"connection\",\"from\":" << conn.fromStationId
+                << ",\"to\":" << conn.toStationId
+                << ",\"pipeId\":" << conn.pipeId << "}\n";
+        }
+        flushOutputChunk(out, false);
+    }
+
+    flushOutputChunk(out, true);
+}
+
+void readDisplayOptions(size_t& offset, size_t& limit, OutputFormat& format) {
+    std::cout << "Format vyvoda (0 - tekst, 1 - CSV, 2 - JSON lines): ";
+    int formatChoice;
+    while (!(std::cin >> formatChoice) || formatChoice < 0 || formatChoice > 2) {
+        std::cout << "Nevernyj vvod. Vvedite 0, 1 ili 2: ";
+        clearInputBuffer();
+    }
+    format = static_cast<OutputFormat>(formatChoice);
+
+    std::cout << "Propustit zapisej (smeshhenie): ";
+    while (!(std::cin >> offset)) {
+        std::cout << "Nevernyj vvod. Vvedite neotricatelnoe celoe chislo: ";
+        clearInputBuffer();
+    }
+
+    std::cout << "Maksimum zapisej (0 - vse): ";
+    while (!(std::cin >> limit)) {
+        std::cout << "Nevernyj vvod. Vvedite neotricatelnoe celoe chislo: ";
+        clearInputBuffer();
+    }
+    clearInputBuffer();
+}
+
+void displayAllObjectsMenu() {
+    size_t offset, limit;
+    OutputFormat format;
+    readDisplayOptions(offset, limit, format);
+
+    int minSection = (format == OutputFormat::Csv) ? 1 : 0;
+    std::cout << "Razdel (" << (minSection == 0 ? "0 - truby i KS, " : "") << "1 - truby, 2 - KS): ";
+    int sectionChoice;
+    while (!(std::cin >> sectionChoice) || sectionChoice < minSection || sectionChoice > 2) {
+        std::cout << "Nevernyj vvod. Vvedite chislo ot " << minSection << " do 2: ";
+        clearInputBuffer();
+    }
+    clearInputBuffer();
+    displayAllObjects(offset, limit, format, static_cast<ObjectSection>(sectionChoice));
+}
+
+void displayNetworkMenu() {
+    size_t offset, limit;
+    OutputFormat format;
+    readDisplayOptions(offset, limit, format);
+    displayNetwork(offset, limit, format);
+}
+
+bool stationExists(int id) {
+    for (const auto& station : stations) {
+        if (station.id == id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void connectStations() {
+    if (stations.size() < 2) {
+        std::cout << "Dolzhno byt minimum 2 KS dlja soedinenija." << std::endl;
+        return;
+    }
+    
+    std::cout << "Dostupnye diametry: 500, 700, 1000, 1400" << std::endl;
+    std::cout << "Vvedite diametr truby: ";
+    int diameter;
+    while (!(std::cin >> diameter) || 
+           (diameter != 500 && diameter != 700 && 
+            diameter != 1000 && diameter != 1400)) {
+        std::cout << "Nevernyj vvod. Vvedite odin iz dostupnyh diametrov (500, 700, 1000, 1400): ";
+        clearInputBuffer();
+    }
+    
+    Pipe* availablePipe = findAvailablePipe(diameter);
+    
+    if (!availablePipe) {
+        std::cout << "Net dostupnyh trub s diametrom " << diameter << " mm." << std::endl;
+        std::cout << "Sozdat novuju trubu? (1 - Da, 0 - Net): ";
+        int choice;
+        std::cin >> choice;
+        clearInputBuffer();
+        
+        if (choice == 1) {
+            addPipe();
+            if (!pipes.empty()) {
+                availablePipe = &pipes.back();
+                if (availablePipe->diameter != diameter) {
+                    std::cout << "Diametr novoj truby ne sovpadaet s trebuemym!" << std::endl;
+                    return;
+                }
+            } else {
+                std::cout << "Oshibka pri sozdanii truby!" << std::endl;
+                return;
+            }
+        } else {
+            return;
+        }
+    }
+    
+    std::cout << "Vvedite ID KS vhoda: ";
+    int fromId;
+    std::cin >> fromId;
+    
+    std::cout << "Vvedite ID KS vyhoda: ";
+    int toId;
+    std::cin >> toId;
+    clearInputBuffer();
+    
+    if (!stationExists(fromId)) {
+        std::cout << "KS s ID " << fromId << " ne sushhestvuet." << std::endl;
+        return;
+    }
+    
+    if (!stationExists(toId)) {
+        std::cout << "KS s ID " << toId << " ne sushhestvuet." << std::endl;
+        return;
+    }
+    
+    if (fromId == toId) {
+        std::cout << "Nelzja soedinit KS s samoj soboj." << std::endl;
+        return;
+    }
+    
+    for (const auto& conn : connections) {
+        if (conn.fromStationId == fromId && conn.toStationId == toId) {
+            std::cout << "Soedinenie uzhe sushhestvuet." << std::endl;
+            return;
+        }
+    }
+    
+    availablePipe->inUse = true;
+    markChanged(changedPipeChunks, pipes, *availablePipe);
+    
+    NetworkConnection newConn(availablePipe->id, fromId, toId);
+    connections.push_back(newConn);
+    markChanged(changedConnectionChunks, connections, connections.back());
+    journalAppend("C " + std::to_string(newConn.pipeId) + " " +
+                  std::to_string(fromId) + " " + std::to_string(toId));
+    networkChanged("Soedinenie: KS " + std::to_string(fromId) + " -> KS " + std::to_string(toId));
+    reachabilityConnected({{fromId, toId}});
+    
+    logAction("Soedinenie: KS " + std::to_string(fromId) + " -> KS " + 
+              std::to_string(toId) + " (Truba ID: " + std::to_string(availablePipe->id) + ")");
+    std::cout << "KS uspeshno soedineny!" << std::endl;
+}
+
+struct LinkRequest {
+    int fromId;
+    int toId;
+    int diameter;
+    double minLength;
+};
+
+// Podbiraet svobodnye truby dlja paketa zaprosov. Dlja kazhdogo diametra truby
+// otsortirovany po dline; zaprosy obrabatyvajutsja po vozrastaniju trebuemoj dliny
+// i poluchajut samuju korotkuju podhodjashhuju trubu, chto minimiziruet summarnuju
+// dlinu. Zanjatye pozicii propuskajutsja cherez "sledujushhij svobodnyj" ukazatel.
+// Vozvrashhaet indeks truby v pipes dlja kazhdogo zaprosa ili -1.
+std::vector<int> assignPipes(const std::vector<LinkRequest>& requests) {
+    struct FreeList {
+        std::vector<std::pair<double, int>> pipesByLength;
+        std::vector<size_t> nextFree;
+
+        size_t findFree(size_t position) {
+            size_t root = position;
+            while (nextFree[root] != root) {
+                root = nextFree[root];
+            }
+            while (nextFree[position] != root) {
+                size_t following = nextFree[position];
+                nextFree[position] = root;
+                position = following;
+            }
+            return root;
+        }
+    };
+
+    std::map<int, FreeList> freeLists;
+    for (size_t i = 0; i < pipes.size(); ++i) {
+        if (pipes[i].isAvailable()) {
+            freeLists[pipes[i].diameter].pipesByLength.push_back({pipes[i].length, static_cast<int>(i)});
+        }
+    }
+    for (auto& [diameter, list] : freeLists) {
+        std::sort(list.pipesByLength.begin(), list.pipesByLength.end());
+        list.nextFree.resize(list.pipesByLength.size() + 1);
+        for (size_t i = 0; i < list.nextFree.size(); ++i) {
+            list.nextFree[i] = i;
+        }
+    }
+
+    std::vector<size_t> order(requests.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&requests](size_t a, size_t b) {
+        return requests[a].minLength < requests[b].minLength;
+    });
+
+    std::vector<int> assigned(requests.size(), -1);
+    for (size_t index : order) {
+        auto it = freeLists.find(requests[index].diameter);
+        if (it == freeLists.end()) {
+            continue;
+        }
+        FreeList& list = it->second;
+        size_t position = std::lower_bound(list.pipesByLength.begin(), list.pipesByLength.end(),
+                                           std::make_pair(requests[index].minLength, -1)) -
+                          list.pipesByLength.begin();
+        position = list.findFree(position);
+        if (position == list.pipesByLength.size()) {
+            continue;
+        }
+        assigned[index] = list.pipesByLength[position].second;
+        list.nextFree[position] = position + 1;
+    }
+    return assigned;
+}
+
+void bulkConnectMenu() {
+    if (stations.size() < 2) {
+        std::cout << "Dolzhno byt minimum 2 KS dlja soedinenija." << std::endl;
+        return;
+    }
+
+    std::cout << "Vvedite imja fajla so spiskom soedinenij" << std::endl;
+    std::cout << "(stroka: ID KS vhoda, ID KS vyhoda, diametr, [minimalnaja dlina]): ";
+    std::string filename;
+    std::getline(std::cin, filename);
+
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cout << "Oshibka otkrytija fajla!" << std::endl;
+        return;
+    }
+
+    std::set<int> stationIds;
+    for (const auto& station : stations) {
+        stationIds.insert(station.id);
+    }
+    std::set<std::pair<int, int>> linked;
+    for (const auto& conn : connections) {
+        linked.insert({conn.fromStationId, conn.toStationId});
+    }
+
+    std::vector<LinkRequest> requests;
+    std::string line;
+    int lineNumber = 0;
+    int rejected = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        std::istringstream input(line);
+        LinkRequest request{0, 0, 0, 0.0};
+        if (!(input >> request.fromId >> request.toId >> request.diameter)) {
+            if (line.find_first_not_of(" \t\r") != std::string::npos) {
+                std::cout << "Stroka " << lineNumber << ": nevernyj format." << std::endl;
+                rejected++;
+            }
+            continue;
+        }
+        input >> request.minLength;
+
+        if (!stationIds.count(request.fromId) || !stationIds.count(request.toId) ||
+            request.fromId == request.toId) {
+            std::cout << "Stroka " << lineNumber << ": nevernye KS." << std::endl;
+            rejected++;
+            continue;
+        }
+        if (!linked.insert({request.fromId, request.toId}).second) {
+            std::cout << "Stroka " << lineNumber << ": soedinenie uzhe sushhestvuet." << std::endl;
+            rejected++;
+            continue;
+        }
+        requests.push_back(request);
+    }
+
+    std::vector<int> assigned = assignPipes(requests);
+
+    int connected = 0;
+    double totalLength = 0.0;
+    std::vector<std::pair<int, int>> links;
+    for (size_t i = 0; i < requests.size(); ++i) {
+        if (assigned[i] < 0) {
+            std::cout << "Net podhodjashhej truby dlja KS " << requests[i].fromId << " -> KS "
+                      << requests[i].toId << " (diametr " << requests[i].diameter << " mm)." << std::endl;
+            continue;
+        }
+        Pipe& pipe = pipes[assigned[i]];
+        pipe.inUse = true;
+        markChanged(changedPipeChunks, pipes, pipe);
+        connections.push_back(NetworkConnection(pipe.id, requests[i].fromId, requests[i].toId));
+        markChanged(changedConnectionChunks, connections, connections.back());
+        journalAppend("C " + std::to_string(pipe.id) + " " +
+                      std::to_string(requests[i].fromId) + " " + std::to_string(requests[i].toId));
+        links.push_back({requests[i].fromId, requests[i].toId});
+        totalLength += pipe.length;
+        connected++;
+    }
+
+    if (connected > 0) {
+        networkChanged("Paketnoe soedinenie: " + std::to_string(connected));
+        reachabilityConnected(links);
+    }
+    logAction("Paketnoe soedinenie iz fajla " + filename + ": " + std::to_string(connected) +
+              " iz " + std::to_string(requests.size() + rejected));
+    std::cout << "Soedineno: " << connected << ", bez truby: " << requests.size() - connected
+              << ", otkloneno: " << rejected << ". Summarnaja dlina trub: " << totalLength << " km" << std::endl;
+}
+
+void disconnectStations() {
+    if (connections.empty()) {
+        std::cout << "Net soedinenij dlja razryva." << std::endl;
+        return;
+    }
+    
+    std::cout << "Vvedite ID KS vhoda: ";
+    int fromId;
+    std::cin >> fromId;
+    
+    std::cout << "Vvedite ID KS vyhoda: ";
+    int toId;
+    std::cin >> toId;
+    clearInputBuffer();
+    
+    for (auto it = connections.begin(); it != connections.end(); ++it) {
+        if (it->fromStationId == fromId && it->toStationId == toId) {
+            for (auto& pipe : pipes) {
+                if (pipe.id == it->pipeId) {
+                    pipe.inUse = false;
+                    markChanged(changedPipeChunks, pipes, pipe);
+                    break;
+                }
+            }
+            
+            markShifted(changedConnectionChunks, it - connections.begin());
+            connections.erase(it);
+            journalAppend("D " + std::to_string(fromId) + " " + std::to_string(toId));
+            networkChanged("Razryv soedinenija: KS " + std::to_string(fromId) + " -> KS " + std::to_string(toId));
+            logAction("Razryv soedinenija: KS " + std::to_string(fromId) + " -> KS " + std::to_string(toId));
+            std::cout << "Soedinenie razorvano!" << std::endl;
+            return;
+        }
+    }
+    
+    std::cout << "Soedinenie ne najdeno." << std::endl;
+}
+
+void topologicalSort() {
+    if (connections.empty()) {
+        std::cout << "Set pusta. Net chto sortirovat." << std::endl;
+        return;
+    }
+    
+    NetworkGraph graph = buildNetworkGraph();
+    std::vector<int> sortedOrder;
+    
+    if (!topologicalOrderOn(graph, sortedOrder)) {
+        std::cout << "V grafe obnaruzhen cikl! Topologicheskaja sortirovka nevozmozhna." << std::endl;
+        return;
+    }
+    
+    std::cout << "\n=== TOPOLOGICHESKAYA SORTIROVKA KS ===" << std::endl;
+    for (size_t i = 0; i < sortedOrder.size(); ++i) {
+        std::cout << i + 1 << ". KS " << graph.stationIds[sortedOrder[i]]
+                  << " (" << graph.stationNames[sortedOrder[i]] << ")" << std::endl;
+    }
+}
+
+double calculateMaxFlow(int sourceId, int sinkId) {
+    if (connections.empty()) {
+        std::cout << "Set pusta." << std::endl;
+        return 0.0;
+    }
+    
+    if (!stationExists(sourceId)) {
+        std::cout << "Istochnik s ID " << sourceId << " ne sushhestvuet." << std::endl;
+        return 0.0;
+    }
+    
+    if (!stationExists(sinkId)) {
+        std::cout << "Stok s ID " << sinkId << " ne sushhestvuet." << std::endl;
+        return 0.0;
+    }
+    
+    if (sourceId == sinkId) {
+        std::cout << "Istochnik i stok ne mogut byt odnoj i toj zhe KS." << std::endl;
+        return 0.0;
+    }
+    
+    NetworkGraph graph = buildNetworkGraph();
+    return maxFlowOn(graph, graph.indexOf(sourceId), graph.indexOf(sinkId), nullptr, activeKernel);
+}
+
+void calculateShortestPath(int startId, int endId) {
+    if (connections.empty()) {
+        std::cout << "Set pusta." << std::endl;
+        return;
+    }
+    
+    if (!stationExists(startId)) {
+        std::cout << "Nachalnaja KS s ID " << startId << " ne sushhestvuet." << std::endl;
+        return;
+    }
+    
+    if (!stationExists(endId)) {
+        std::cout << "Konechnaja KS s ID " << endId << " ne sushhestvuet." << std::endl;
+        return;
+    }
+    
+    if (startId == endId) {
+        std::cout << "Nachalnaja i konechnaja KS ne mogut byt odnoj i toj zhe." << std::endl;
+        return;
+    }
+    
+    NetworkGraph graph = buildNetworkGraph();
+    double distance;
+    std::vector<int> path;
+    
+    if (!shortestPathOn(graph, graph.indexOf(startId), graph.indexOf(endId), distance, path, activeKernel)) {
+        std::cout << "Put mezhdu KS " << startId << " i KS " << endId << " ne najden." << std::endl;
+        return;
+    }
+    
+    std::cout << "\n=== KRATCHAISHIJ PUT ===" << std::endl;
+    std::cout << "Ot KS " << startId << " do KS " << endId << std::endl;
+    std::cout << "Obshhaja dlina: " << distance << " km" << std::endl;
+    std::cout << "Marshrut: ";
+    
+    for (size_t i = 0; i < path.size(); ++i) {
+        std::cout << "KS " << graph.stationIds[path[i]] << " (" << graph.stationNames[path[i]] << ")";
+        if (i < path.size() - 1) {
+            std::cout << " -> ";
+        }
+    }
+    std::cout << std::endl;
+}
+
+void maxFlowMenu() {
+    if (stations.empty()) {
+        std::cout << "Net KS dlja rascheta." << std::endl;
+        return;
+    }
+    
+    std::cout << "Vvedite ID KS istochnika: ";
+    int sourceId;
+    std::cin >> sourceId;
+    
+    std::cout << "Vvedite ID KS stoka: ";
+    int sinkId;
+    std::cin >> sinkId;
+    clearInputBuffer();
+    
+    double maxFlow = calculateMaxFlow(sourceId, sinkId);
+    
+    std::cout << "\n=== MAKSIMALNYJ POTOK ===" << std::endl;
+    std::cout << "Ot KS " << sourceId << " do KS " << sinkId << std::endl;
+    std::cout << "Maksimalnyj potok: " << maxFlow << " ed." << std::endl;
+    
+    logAction("Raschet maksimalnogo potoka: KS " + std::to_string(sourceId) + 
+              " -> KS " + std::to_string(sinkId) + " = " + std::to_string(maxFlow) + " ed.");
+}
+
+void shortestPathMenu() {
+    if (stations.empty()) {
+        std::cout << "Net KS dlja rascheta." << std::endl;
+        return;
+    }
+    
+    std::cout << "Vvedite ID nachalnoj KS: ";
+    int startId;
+    std::cin >> startId;
+    
+    std::cout << "Vvedite ID konechnoj KS: ";
+    int endId;
+    std::cin >> endId;
+    clearInputBuffer();
+    
+    calculateShortestPath(startId, endId);
+}
+
+NetworkGraph undirectedView(const NetworkGraph& graph) {
+    NetworkGraph undirected = graph;
+    for (const auto& edge : graph.edges) {
+        undirected.outEdges[edge.to].push_back(static_cast<int>(undirected.edges.size()));
+        undirected.edges.push_back({edge.to, edge.from, edge.capacity, edge.weight,
+                                    edge.capacityUnits, edge.lengthFixed});
+    }
+    return undirected;
+}
+
+// Derevo Gomori-Hu po algoritmu Gusfilda: n-1 vychislenij potoka dajut derevo,
+// v kotorom minimalnyj razrez mezhdu ljubymi dvumja KS raven minimalnomu vesu
+// rebra na puti mezhdu nimi.
+void gomoryHuTree(const NetworkGraph& graph, std::vector<int>& parent, std::vector<double>& cut) {
+    size_t n = graph.stationIds.size();
+    parent.assign(n, 0);
+    cut.assign(n, 0.0);
+    std::vector<char> sourceSide;
+    for (size_t s = 1; s < n; ++s) {
+        int t = parent[s];
+        cut[s] = maxFlowOn(graph, static_cast<int>(s), t, &sourceSide, activeKernel);
+        for (size_t v = s + 1; v < n; ++v) {
+            if (sourceSide[v] && parent[v] == t) {
+                parent[v] = static_cast<int>(s);
+            }
+        }
+    }
+}
+
+void flowMatrixMenu() {
+    if (stations.size() < 2 || connections.empty()) {
+        std::cout << "Nedostatochno dannyh dlja rascheta." << std::endl;
+        return;
+    }
+
+    int sourceClass, sinkClass, mode;
+    std::cout << "Vvedite klass KS istochnikov: ";
+    while (!(std::cin >> sourceClass) || sourceClass <= 0) {
+        std::cout << "Nevernyj vvod. Vvedite polozhitelnoe celoe chislo: ";
+        clearInputBuffer();
+    }
+    std::cout << "Vvedite klass KS stokov: ";
+    while (!(std::cin >> sinkClass) || sinkClass <= 0) {
+        std::cout << "Nevernyj vvod. Vvedite polozhitelnoe celoe chislo: ";
+        clearInputBuffer();
+    }
+    std::cout << "Rezhim (1 - napravlennaja set, 2 - nenapravlennaja set, derevo Gomori-Hu): ";
+    while (!(std::cin >> mode) || (mode != 1 && mode != 2)) {
+        std::cout << "Nevernyj vvod. Vvedite 1 ili 2: ";
+        clearInputBuffer();
+    }
+    clearInputBuffer();
+    std::cout << "Imja fajla dlja eksporta CSV (pustaja stroka - vyvod na ekran): ";
+    std::string filename;
+    std::getline(std::cin, filename);
+
+    NetworkGraph graph = buildNetworkGraph();
+    std::vector<int> sources, sinks;
+    for (size_t v = 0; v < graph.stationIds.size(); ++v) {
+        if (graph.stationClasses[v] == sourceClass) sources.push_back(static_cast<int>(v));
+        if (graph.stationClasses[v] == sinkClass) sinks.push_back(static_cast<int>(v));
+    }
+    if (sources.empty() || sinks.empty()) {
+        std::cout << "Net KS zadannyh klassov." << std::endl;
+        return;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    std::vector<double> matrix(sources.size() * sinks.size(), 0.0);
+
+    const auto pairFlows = [&](const NetworkGraph& flowGraph) {
+        parallelFor(matrix.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t cell = begin; cell < end; ++cell) {
+                int s = sources[cell / sinks.size()];
+                int t = sinks[cell % sinks.size()];
+                if (s != t) {
+                    matrix[cell] = maxFlowOn(flowGraph, s, t, nullptr, activeKernel);
+                }
+            }
+        });
+    };
+
+    // Derevo Gomori-Hu stoit n-1 posledovatelnyh potokov po vsej seti; esli par
+    // menshe, vygodnee poschitat kazhduju paru naprjamuju i parallelno.
+    size_t n = graph.stationIds.size();
+    if (mode == 1) {
+        pairFlows(graph);
+    } else if (matrix.size() < n - 1) {
+        pairFlows(undirectedView(graph));
+    } else {
+        NetworkGraph undirected = undirectedView(graph);
+        std::vector<int> treeParent;
+        std::vector<double> treeCut;
+        gomoryHuTree(undirected, treeParent, treeCut);
+
+        std::vector<std::vector<std::pair<int, double>>> tree(n);
+        for (size_t v = 1; v < n; ++v) {
+            tree[v].push_back({treeParent[v], treeCut[v]});
+            tree[treeParent[v]].push_back({static_cast<int>(v), treeCut[v]});
+        }
+        parallelFor(sources.size(), 1, [&](size_t begin, size_t end) {
+            std::vector<double> bottleneck(n);
+            std::vector<char> visited(n);
+            for (size_t row = begin; row < end; ++row) {
+                std::fill(visited.begin(), visited.end(), 0);
+                std::stack<int> pending;
+                pending.push(sources[row]);
+                visited[sources[row]] = 1;
+                bottleneck[sources[row]] = std::numeric_limits<double>::infinity();
+                while (!pending.empty()) {
+                    int current = pending.top();
+                    pending.pop();
+                    for (const auto& [neighbor, capacity] : tree[current]) {
+                        if (!visited[neighbor]) {
+                            visited[neighbor] = 1;
+                            bottleneck[neighbor] = std::min(bottleneck[current], capacity);
+                            pending.push(neighbor);
+                        }
+                    }
+                }
+                for (size_t col = 0; col < sinks.size(); ++col) {
+                    if (sinks[col] != sources[row]) {
+                        matrix[row * sinks.size() + col] = bottleneck[sinks[col]];
+                    }
+                }
+            }
+        });
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    std::ostringstream out;
+    out << "istochnik\\stok";
+    for (int t : sinks) {
+        out << ",KS " << graph.stationIds[t];
+    }
+    out << '\n';
+    for (size_t row = 0; row < sources.size(); ++row) {
+        out << "KS " << graph.stationIds[sources[row]];
+        for (size_t col = 0; col < sinks.size(); ++col) {
+            out << ',' << matrix[row * sinks.size() + col];
+        }
+        out << '\n';
+    }
+
+    if (filename.empty()) {
+        std::cout << "\n=== MATRICA MAKSIMALNYH POTOKOV ===\n" << out.str() << std::flush;
+    } else {
+        std::ofstream file(filename);
+        if (!file.is_open()) {
+            std::cout << "Oshibka sohranenija fajla!" << std::endl;
+            return;
+        }
+        file << out.str();
+        std::cout << "Matrica sohranena v fajl: " << filename << std::endl;
+    }
+    std::cout << "Par: " << matrix.size() << ", vremja rascheta: " << seconds << " s" << std::endl;
+    logAction("Matrica maksimalnyh potokov: klass " + std::to_string(sourceClass) + " -> klass " +
+              std::to_string(sinkClass) + ", par: " + std::to_string(matrix.size()));
+}
+
+template <typename Neighbors>
+void dijkstraOn(size_t nodeCount, int start, int stop, Neighbors forEachNeighbor,
+                std::vector<double>& dist, std::vector<int>& parent) {
+    dist.assign(nodeCount, std::numeric_limits<double>::infinity());
+    parent.assign(nodeCount, -1);
+    std::priority_queue<std::pair<double, int>, std::vector<std::pair<double, int>>,
+                        std::greater<std::pair<double, int>>> pq;
+    dist[start] = 0.0;
+    pq.push({0.0, start});
+    while (!pq.empty()) {
+        auto [currentDist, current] = pq.top();
+        pq.pop();
+        if (currentDist > dist[current]) {
+            continue;
+        }
+        if (current == stop) {
+            break;
+        }
+        forEachNeighbor(current, [&](int neighbor, double weight) {
+            double newDist = currentDist + weight;
+            if (newDist < dist[neighbor]) {
+                dist[neighbor] = newDist;
+                parent[neighbor] = current;
+                pq.push({newDist, neighbor});
+                return true;
+            }
+            return false;
+        });
+    }
+}
+
+// Razbienie seti na regiony. Regiony rastut poiskom v shirinu do zadannogo razmera,
+// zatem neskolko prohodov perenosjat KS v region bolshinstva sosedej, umenshaja
+// chislo razrezannyh trub. Dlja kazhdogo regiona parallelno schitajutsja kratchajshie
+// rasstojanija mezhdu ego granichnymi KS (overlej), i zaprosy idut po overleju,
+// zahodja vnutr tolko regionov nachalnoj i konechnoj KS.
+struct NetworkPartition {
+    std::shared_ptr<const NetworkVersion> version;
+    NetworkGraph graph;
+    size_t requestedSize = 0;  // razmer, zadannyj polzovatelem; 0 - avtomaticheski
+    size_t targetSize = 0;
+    int regionCount = 0;
+    std::vector<int> region;
+    std::vector<char> boundary;
+    std::vector<std::vector<std::pair<int, double>>> shortcuts;
+    size_t cutEdges = 0;
+    size_t boundaryCount = 0;
+};
+
+std::shared_ptr<const NetworkPartition> currentPartition;
+
+void regionShortestPath(const NetworkPartition& partition, int start, int end,
+                        std::vector<double>& dist, std::vector<int>& parent) {
+    const NetworkGraph& graph = partition.graph;
+    int regionId = partition.region[start];
+    dijkstraOn(graph.stationIds.size(), start, end, [&](int node, auto relax) {
+        for (int edgeIndex : graph.outEdges[node]) {
+            const GraphEdge& edge = graph.edges[edgeIndex];
+            if (usableEdge(edge) && partition.region[edge.to] == regionId) {
+                relax(edge.to, edge.weight);
+            }
+        }
+    }, dist, parent);
+}
+
+std::shared_ptr<const NetworkPartition> buildPartition(size_t targetSize) {
+    auto partition = std::make_shared<NetworkPartition>();
+    partition->version = currentVersion();
+    partition->graph = buildNetworkGraph();
+    const NetworkGraph& graph = partition->graph;
+    size_t n = graph.stationIds.size();
+    partition->requestedSize = targetSize;
+    if (targetSize == 0) {
+        targetSize = std::max<size_t>(1, static_cast<size_t>(std::sqrt(static_cast<double>(n))));
+    }
+    partition->targetSize = targetSize;
+
+    std::vector<std::vector<int>> neighbors(n);
+    for (const auto& edge : graph.edges) {
+        if (usableEdge(edge) && edge.from != edge.to) {
+            neighbors[edge.from].push_back(edge.to);
+            neighbors[edge.to].push_back(edge.from);
+        }
+    }
+
+    std::vector<int>& region = partition->region;
+    region.assign(n, -1);
+    std::vector<size_t> regionSize;
+    for (size_t seed = 0; seed < n; ++seed) {
+        if (region[seed] != -1) {
+            continue;
+        }
+        int regionId = static_cast<int>(regionSize.size());
+        regionSize.push_back(0);
+        std::queue<int> q;
+        q.push(static_cast<int>(seed));
+        while (!q.empty() && regionSize[regionId] < targetSize) {
+            int current = q.front();
+            q.pop();
+            if (region[current] != -1) {
+                continue;
+            }
+            region[current] = regionId;
+            regionSize[regionId]++;
+            for (int neighbor : neighbors[current]) {
+                if (region[neighbor] == -1) {
+                    q.push(neighbor);
+                }
+            }
+        }
+    }
+    partition->regionCount = static_cast<int>(regionSize.size());
+
+    const size_t maxSize = targetSize + targetSize / 10 + 1;
+    std::map<int, int> neighborRegions;
+    for (int pass = 0; pass < 3; ++pass) {
+        bool moved = false;
+        for (size_t v = 0; v < n; ++v) {
+            neighborRegions.clear();
+            for (int neighbor : neighbors[v]) {
+                neighborRegions[region[neighbor]]++;
+            }
+            int current = region[v];
+            int best = current;
+            for (const auto& [regionId, count] : neighborRegions) {
+                if (count > neighborRegions[best] && regionSize[regionId] < maxSize) {
+                    best = regionId;
+                }
+            }
+            if (best != current && regionSize[current] > 1) {
+                regionSize[current]--;
+                regionSize[best]++;
+                region[v] = best;
+                moved = true;
+            }
+        }
+        if (!moved) {
+            break;
+        }
+    }
+
+    partition->boundary.assign(n, 0);
+    for (const auto& edge : graph.edges) {
+        if (usableEdge(edge) && region[edge.from] != region[edge.to]) {
+            partition->boundary[edge.from] = 1;
+            partition->boundary[edge.to] = 1;
+            partition->cutEdges++;
+        }
+    }
+
+    std::vector<std::vector<int>> regionBoundary(partition->regionCount);
+    for (size_t v = 0; v < n; ++v) {
+        if (partition->boundary[v]) {
+            regionBoundary[region[v]].push_back(static_cast<int>(v));
+            partition->boundaryCount++;
+        }
+    }
+
+    // Kazhdyj potok rabotaet s lokalnoj numeraciej svoego regiona, chtoby rabochij
+    // nabor ostavalsja kompaktnym.
+    partition->shortcuts.resize(n);
+    std::vector<std::vector<int>> regionNodes(partition->regionCount);
+    for (size_t v = 0; v < n; ++v) {
+        regionNodes[region[v]].push_back(static_cast<int>(v));
+    }
+    parallelFor(regionNodes.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t r = begin; r < end; ++r) {
+            const std::vector<int>& nodes = regionNodes[r];
+            if (regionBoundary[r].size() < 2) {
+                continue;
+            }
+            std::map<int, int> localIndex;
+            for (size_t i = 0; i < nodes.size(); ++i) {
+                localIndex[nodes[i]] = static_cast<int>(i);
+            }
+            std::vector<std::vector<std::pair<int, double>>> localEdges(nodes.size());
+            for (size_t i = 0; i < nodes.size(); ++i) {
+                for (int edgeIndex : graph.outEdges[nodes[i]]) {
+                    const GraphEdge& edge = graph.edges[edgeIndex];
+                    if (usableEdge(edge) && region[edge.to] == static_cast<int>(r)) {
+                        localEdges[i].push_back({localIndex[edge.to], edge.weight});
+                    }
+                }
+            }
+
+            std::vector<double> dist;
+            std::vector<int> parent;
+            for (int from : regionBoundary[r]) {
+                dijkstraOn(nodes.size(), localIndex[from], -1, [&](int node, auto relax) {
+                    for (const auto& [to, weight] : localEdges[node]) {
+                        relax(to, weight);
+                    }
+                }, dist, parent);
+                for (int to : regionBoundary[r]) {
+                    double d = dist[localIndex[to]];
+                    if (to != from && d != std::numeric_limits<double>::infinity()) {
+                        partition->shortcuts[from].push_back({to, d});
+                    }
+                }
+            }
+        }
+    });
+
+    return partition;
+}
+
+bool partitionedShortestPath(const NetworkPartition& partition, int start, int end,
+                             double& distance, std::vector<int>& path) {
+    const NetworkGraph& graph = partition.graph;
+    int startRegion = partition.region[start];
+    int endRegion = partition.region[end];
+    std::vector<double> dist;
+    std::vector<int> parent;
+    // Otmechaet vershiny, v kotorye poslednee uluchshenie prishlo po yarlyku oblasti.
+    std::vector<char> viaShortcut(graph.stationIds.size(), 0);
+
+    dijkstraOn(graph.stationIds.size(), start, end, [&](int node, auto relax) {
+        bool inside = partition.region[node] == startRegion || partition.region[node] == endRegion;
+        for (int edgeIndex : graph.outEdges[node]) {
+            const GraphEdge& edge = graph.edges[edgeIndex];
+            if (usableEdge(edge) && (inside || partition.region[edge.to] != partition.region[node]) &&
+                relax(edge.to, edge.weight)) {
+                viaShortcut[edge.to] = 0;
+            }
+        }
+        if (!inside) {
+            for (const auto& [to, weight] : partition.shortcuts[node]) {
+                if (relax(to, weight)) {
+                    viaShortcut[to] = 1;
+                }
+            }
+        }
+    }, dist, parent);
+
+    if (dist[end] == std::numeric_limits<double>::infinity()) {
+        return false;
+    }
+    distance = dist[end];
+
+    std::vector<int> hops;
+    for (int v = end; v != -1; v = parent[v]) {
+        hops.push_back(v);
+    }
+    std::reverse(hops.begin(), hops.end());
+
+    path.assign(1, hops[0]);
+    std::vector<double> regionDist;
+    std::vector<int> regionParent;
+    for (size_t i = 1; i < hops.size(); ++i) {
+        int from = hops[i - 1];
+        int to = hops[i];
+        if (!viaShortcut[to]) {
+            path.push_back(to);
+            continue;
+        }
+        regionShortestPath(partition, from, to, regionDist, regionParent);
+        std::vector<int> segment;
+        for (int v = to; v != from; v = regionParent[v]) {
+            if (v == -1) {
+                return false;
+            }
+            segment.push_back(v);
+        }
+        path.insert(path.end(), segment.rbegin(), segment.rend());
+    }
+    return true;
+}
+
+// Pri izmenenii seti razbienie perestraivaetsja s razmerom regiona, vybrannym ranee.
+std::shared_ptr<const NetworkPartition> freshPartition(size_t targetSize) {
+    if (targetSize == 0 && currentPartition) {
+        targetSize = currentPartition->requestedSize;
+    }
+    if (!currentPartition || currentPartition->version != currentVersion() ||
+        targetSize != currentPartition->requestedSize) {
+        currentPartition = buildPartition(targetSize);
+    }
+    return currentPartition;
+}
+
+void regionAnalysisMenu() {
+    if (stations.size() < 2) {
+        std::cout << "Nedostatochno KS dlja analiza." << std::endl;
+        return;
+    }
+
+    std::cout << "1. Razbit set na regiony" << std::endl;
+    std::cout << "2. Kratchajshij put cherez regiony" << std::endl;
+    std::cout << "3. Proverka dostizhimosti" << std::endl;
+    std::cout << "Vyberite dejstvie: ";
+    int choice;
+    while (!(std::cin >> choice) || choice < 1 || choice > 3) {
+        std::cout << "Nevernyj vvod. Vvedite chislo ot 1 do 3: ";
+        clearInputBuffer();
+    }
+
+    if (choice == 1) {
+        std::cout << "Vvedite razmer regiona (0 - avtomaticheski): ";
+        size_t targetSize;
+        while (!(std::cin >> targetSize)) {
+            std::cout << "Nevernyj vvod. Vvedite neotricatelnoe celoe chislo: ";
+            clearInputBuffer();
+        }
+        clearInputBuffer();
+
+        auto started = std::chrono::steady_clock::now();
+        currentPartition = buildPartition(targetSize);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+        std::cout << "\n=== RAZBIENIE SETI ===" << std::endl;
+        std::cout << "Regionov: " << currentPartition->regionCount
+                  << ", razrezannyh trub: " << currentPartition->cutEdges
+                  << ", granichnyh KS: " << currentPartition->boundaryCount
+                  << ", vremja: " << seconds << " s" << std::endl;
+        logAction("Razbienie seti na regiony: " + std::to_string(currentPartition->regionCount));
+        return;
+    }
+
+    std::cout << "Vvedite ID nachalnoj KS: ";
+    int startId;
+    std::cin >> startId;
+    std::cout << "Vvedite ID konechnoj KS: ";
+    int endId;
+    std::cin >> endId;
+    clearInputBuffer();
+
+    auto partition = freshPartition(0);
+    int start = partition->graph.indexOf(startId);
+    int end = partition->graph.indexOf(endId);
+    if (start < 0 || end < 0 || start == end) {
+        std::cout << "Nevernye ID KS." << std::endl;
+        return;
+    }
+
+    double distance;
+    std::vector<int> path;
+    bool found = partitionedShortestPath(*partition, start, end, distance, path);
+    if (choice == 3) {
+        std::cout << "KS " << endId << (found ? " dostizhima" : " nedostizhima")
+                  << " iz KS " << startId << "." << std::endl;
+        return;
+    }
+    if (!found) {
+        std::cout << "Put mezhdu KS " << startId << " i KS " << endId << " ne najden." << std::endl;
+        return;
+    }
+
+    std::cout << "\n=== KRATCHAISHIJ PUT (PO REGIONAM) ===" << std::endl;
+    std::cout << "Obshhaja dlina: " << distance << " km" << std::endl;
+    std::cout << "Marshrut: ";
+    for (size_t i = 0; i < path.size(); ++i) {
+        std::cout << "KS " << partition->graph.stationIds[path[i]]
+                  << " [R" << partition->region[path[i]] << "]";
+        if (i < path.size() - 1) {
+            std::cout << " -> ";
+        }
+    }
+    std::cout << std::endl;
+}
+
+void reachabilityMenu() {
+    if (stations.empty()) {
+        std::cout << "Net KS dlja proverki." << std::endl;
+        return;
+    }
+
+    std::cout << "Vvedite ID KS vhoda: ";
+    int fromId;
+    std::cin >> fromId;
+    std::cout << "Vvedite ID KS vyhoda: ";
+    int toId;
+    std::cin >> toId;
+    clearInputBuffer();
+
+    if (!stationExists(fromId) || !stationExists(toId)) {
+        std::cout << "KS ne sushhestvuet." << std::endl;
+        return;
+    }
+
+    bool connected = stationsConnected(fromId, toId);
+    bool reachable = connected && stationReachable(fromId, toId);
+    std::cout << "KS " << fromId << " i KS " << toId
+              << (connected ? " svjazany" : " ne svjazany") << " (bez ucheta napravlenija)." << std::endl;
+    std::cout << "Gaz " << (reachable ? "mozhet" : "ne mozhet") << " projti ot KS " << fromId
+              << " k KS " << toId << "." << std::endl;
+}
+
+void kernelMenu() {
+    std::cout << "Tekushhie algoritmy: "
+              << (activeKernel == KernelMode::Integer ? "celochislennye" : "s plavajushhej tochkoj") << std::endl;
+    std::cout << "1. Algoritmy s plavajushhej tochkoj" << std::endl;
+    std::cout << "2. Celochislennye algoritmy (masshtabirovanie potoka, radix-kucha)" << std::endl;
+    std::cout << "3. Sravnit proizvoditelnost" << std::endl;
+    std::cout << "Vyberite dejstvie: ";
+    int choice;
+    while (!(std::cin >> choice) || choice < 1 || choice > 3) {
+        std::cout << "Nevernyj vvod. Vvedite chislo ot 1 do 3: ";
+        clearInputBuffer();
+    }
+
+    if (choice != 3) {
+        clearInputBuffer();
+        activeKernel = (choice == 2) ? KernelMode::Integer : KernelMode::Floating;
+        logAction(std::string("Vybrany algoritmy: ") + (choice == 2 ? "celochislennye" : "s plavajushhej tochkoj"));
+        std::cout << "Algoritmy pereklyucheny." << std::endl;
+        return;
+    }
+
+    std::cout << "Vvedite kolichestvo sluchajnyh par KS: ";
+    int pairCount;
+    while (!(std::cin >> pairCount) || pairCount <= 0) {
+        std::cout << "Nevernyj vvod. Vvedite polozhitelnoe celoe chislo: ";
+        clearInputBuffer();
+    }
+    clearInputBuffer();
+
+    NetworkGraph graph = buildNetworkGraph();
+    int n = static_cast<int>(graph.stationIds.size());
+    if (n < 2) {
+        std::cout << "Nedostatochno KS dlja sravnenija." << std::endl;
+        return;
+    }
+
+    std::vector<std::pair<int, int>> queries;
+    unsigned int seed = 12345;
+    while (static_cast<int>(queries.size()) < pairCount) {
+        seed = seed * 1103515245u + 12345u;
+        int from = static_cast<int>((seed >> 8) % n);
+        seed = seed * 1103515245u + 12345u;
+        int to = static_cast<int>((seed >> 8) % n);
+        if (from != to) {
+            queries.push_back({from, to});
+        }
+    }
+
+    const auto timeRun = [&queries](auto run) {
+        auto started = std::chrono::steady_clock::now();
+        for (const auto& [from, to] : queries) {
+            run(from, to);
+        }
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    };
+
+    std::vector<double> flowDouble, flowInteger, pathDouble, pathInteger;
+    std::vector<int> path;
+    double flowDoubleTime = timeRun([&](int from, int to) {
+        flowDouble.push_back(maxFlowOn(graph, from, to, nullptr, KernelMode::Floating));
+    });
+    double flowIntegerTime = timeRun([&](int from, int to) {
+        flowInteger.push_back(maxFlowOn(graph, from, to, nullptr, KernelMode::Integer));
+    });
+    double pathDoubleTime = timeRun([&](int from, int to) {
+        double distance = -1.0;
+        shortestPathOn(graph, from, to, distance, path, KernelMode::Floating);
+        pathDouble.push_back(distance);
+    });
+    double pathIntegerTime = timeRun([&](int from, int to) {
+        double distance = -1.0;
+        shortestPathOn(graph, from, to, distance, path, KernelMode::Integer);
+        pathInteger.push_back(distance);
+    });
+
+    int flowMismatches = 0;
+    double maxPathDifference = 0.0;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        if (flowDouble[i] != flowInteger[i]) {
+            flowMismatches++;
+        }
+        maxPathDifference = std::max(maxPathDifference, std::fabs(pathDouble[i] - pathInteger[i]));
+    }
+
+    std::cout << "\n=== SRAVNENIE ALGORITMOV (" << queries.size() << " par) ===" << std::endl;
+    std::cout << "Maksimalnyj potok: double " << flowDoubleTime << " s, celye " << flowIntegerTime
+              << " s, rashozhdenij: " << flowMismatches << std::endl;
+    std::cout << "Kratchajshij put: double " << pathDoubleTime << " s, fiksirovannaja tochka "
+              << pathIntegerTime << " s, maks. raznica: " << maxPathDifference << " km" << std::endl;
+}
+
+std::string answerQuery(const NetworkGraph& graph, const std::string& line) {
+    std::istringstream input(line);
+    std::string command;
+    input >> command;
+    std::ostringstream reply;
+
+    if (command == "PING") {
+        reply << "OK";
+    } else if (command == "MAXFLOW" || command == "PATH") {
+        int fromId, toId;
+        if (!(input >> fromId >> toId)) {
+            return "ERR ozhidajutsja dva ID KS";
+        }
+        int from = graph.indexOf(fromId);
+        int to = graph.indexOf(toId);
+        if (from < 0 || to < 0) {
+            return "ERR KS ne sushhestvuet";
+        }
+        if (from == to) {
+            return "ERR KS dolzhny razlichatsja";
+        }
+        std::string kernel;
+        input >> kernel;
+        KernelMode mode = (kernel == "INT") ? KernelMode::Integer : KernelMode::Floating;
+        if (command == "MAXFLOW") {
+            reply << "OK " << maxFlowOn(graph, from, to, nullptr, mode);
+        } else {
+            double distance;
+            std::vector<int> path;
+            if (!shortestPathOn(graph, from, to, distance, path, mode)) {
+                return "NOPATH";
+            }
+            reply << "OK " << distance;
+            for (int v : path) {
+                reply << ' ' << graph.stationIds[v];
+            }
+        }
+    } else if (command == "TOPO") {
+        std::vector<int> order;
+        if (!topologicalOrderOn(graph, order)) {
+            return "CYCLE";
+        }
+        reply << "OK";
+        for (int v : order) {
+            reply << ' ' << graph.stationIds[v];
+        }
+    } else {
+        reply << "ERR neizvestnaja komanda: " << command;
+    }
+    return reply.str();
+}
+
+#ifndef _WIN32
+
+// Server zaprosov tolko chitaet opublikovannyj snimok; vse izmenenija seti
+// po-prezhnemu vypolnjajutsja iz menju i publikujutsja cherez publishSnapshot().
+// Zapis v zakrytyj klientom soket ne dolzhna ubivat process signalom SIGPIPE:
+// v Linux eto delaet MSG_NOSIGNAL, v macOS i BSD - opcija soketa SO_NOSIGPIPE.
+#ifdef MSG_NOSIGNAL
+const int SERVER_SEND_FLAGS = MSG_NOSIGNAL;
+#else
+const int SERVER_SEND_FLAGS = 0;
+#endif
+
+// Odin potok sobytij zhdet v poll() na vseh soedinenijah i peredaet rabochim
+// potokam tolko gotovye stroki zaprosov, poetomu prostaivajushhie klienty ne
+// zanimajut rabochie potoki. Poka zapros klienta obrabatyvaetsja, ego soket ne
+// oprashivaetsja: otvety odnomu klientu uhodjat v porjadke zaprosov.
+struct ServerClient {
+    std::string buffer;
+    bool busy = false;
+};
+
+struct ServerJob {
+    int client;
+    std::vector<std::string> lines;
+};
+
+int serverSocket = -1;
+int serverWakePipe[2] = {-1, -1};
+std::string serverSocketPath;
+std::atomic<bool> serverStopping(false);
+std::thread serverEventThread;
+std::vector<std::thread> serverWorkers;
+std::map<int, ServerClient> serverClients;
+std::queue<ServerJob> serverJobs;
+std::mutex serverMutex;
+std::condition_variable serverCondition;
+
+void wakeServerEventLoop() {
+    char signal = 1;
+    ssize_t written = write(serverWakePipe[1], &signal, 1);
+    (void)written;
+}
+
+bool sendAll(int client, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t result = send(client, data.data() + sent, data.size() - sent, SERVER_SEND_FLAGS);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        sent += static_cast<size_t>(result);
+    }
+    return true;
+}
+
+void serverWorkerLoop() {
+    while (true) {
+        ServerJob job;
+        {
+            std::unique_lock<std::mutex> lock(serverMutex);
+            serverCondition.wait(lock, [] { return serverStopping.load() || !serverJobs.empty(); });
+            if (serverStopping.load()) {
+                return;
             }
+            job = std::move(serverJobs.front());
+            serverJobs.pop();
+        }
+
+        std::shared_ptr<const NetworkGraph> graph = std::atomic_load(&publishedGraph);
+        std::string reply;
+        for (const auto& line : job.lines) {
+            reply += answerQuery(*graph, line) + "\n";
+        }
+        sendAll(job.client, reply);
+
+        {
+            std::lock_guard<std::mutex> lock(serverMutex);
+            serverClients[job.client].busy = false;
         }
-        std::cout << i + 1 << ". KS " << sortedOrder[i] << " (" << stationName << ")" << std::endl;
+        wakeServerEventLoop();
     }
 }
 
-double calculateMaxFlow(int sourceId, int sinkId) {
-    if (connections.empty()) {
-        std::cout << "Set pusta." << std::endl;
-        return 0.0;
-    }
-    
-    if (!stationExists(sourceId)) {
-        std::cout << "Istochnik s ID " << sourceId << " ne sushhestvuet." << std::endl;
-        return 0.0;
-    }
-    
-    if (!stationExists(sinkId)) {
-        std::cout << "Stok s ID " << sinkId << " ne sushhestvuet." << std::endl;
-        return 0.0;
-    }
-    
-    if (sourceId == sinkId) {
-        std::cout << "Istochnik i stok ne mogut byt odnoj i toj zhe KS." << std::endl;
-        return 0.0;
+// Chitaet dostupnye dannye klienta; vozvrashhaet false, esli soedinenie zakryto.
+bool readClientRequests(int client, ServerClient& state) {
+    char chunk[4096];
+    ssize_t received = recv(client, chunk, sizeof(chunk), 0);
+    if (received <= 0) {
+        return received < 0 && errno == EINTR;
     }
-    
-    std::map<int, std::vector<std::pair<int, double>>> graph;
-    
-    for (const auto& conn : connections) {
-        double capacity = 0.0;
-        for (const auto& pipe : pipes) {
-            if (pipe.id == conn.pipeId) {
-                capacity = pipe.getCapacity();
-                break;
-            }
+    state.buffer.append(chunk, static_cast<size_t>(received));
+
+    ServerJob job{client, {}};
+    size_t lineEnd;
+    while ((lineEnd = state.buffer.find('\n')) != std::string::npos) {
+        std::string line = state.buffer.substr(0, lineEnd);
+        state.buffer.erase(0, lineEnd + 1);
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
         }
-        
-        graph[conn.fromStationId].push_back({conn.toStationId, capacity});
-        graph[conn.toStationId].push_back({conn.fromStationId, 0.0});
+        job.lines.push_back(line);
     }
-    
-    std::map<int, std::map<int, double>> flow;
-    for (const auto& [from, neighbors] : graph) {
-        for (const auto& [to, cap] : neighbors) {
-            flow[from][to] = 0.0;
+    if (!job.lines.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(serverMutex);
+            state.busy = true;
+            serverJobs.push(std::move(job));
         }
+        serverCondition.notify_one();
     }
-    
-    double maxFlow = 0.0;
-    
-    while (true) {
-        std::map<int, int> parent;
-        std::queue<int> q;
-        q.push(sourceId);
-        parent[sourceId] = -1;
-        
-        while (!q.empty() && parent.find(sinkId) == parent.end()) {
-            int current = q.front();
-            q.pop();
-            
-            for (const auto& [neighbor, capacity] : graph[current]) {
-                if (parent.find(neighbor) == parent.end() && 
-                    capacity > flow[current][neighbor]) {
-                    parent[neighbor] = current;
-                    q.push(neighbor);
+    return true;
+}
+
+void serverEventLoop() {
+    std::vector<pollfd> polled;
+    while (!serverStopping.load()) {
+        polled.assign({{serverSocket, POLLIN, 0}, {serverWakePipe[0], POLLIN, 0}});
+        {
+            std::lock_guard<std::mutex> lock(serverMutex);
+            for (const auto& [client, state] : serverClients) {
+                if (!state.busy) {
+                    polled.push_back({client, POLLIN, 0});
                 }
             }
         }
-        
-        if (parent.find(sinkId) == parent.end()) {
+        if (poll(polled.data(), polled.size(), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
             break;
         }
-        
-        double pathFlow = std::numeric_limits<double>::infinity();
-        for (int v = sinkId; v != sourceId; v = parent[v]) {
-            int u = parent[v];
-            pathFlow = std::min(pathFlow, graph[u].at(v) - flow[u][v]);
+        if (serverStopping.load()) {
+            break;
         }
-        
-        for (int v = sinkId; v != sourceId; v = parent[v]) {
-            int u = parent[v];
-            flow[u][v] += pathFlow;
-            flow[v][u] -= pathFlow;
+
+        if (polled[1].revents) {
+            char drained[64];
+            while (read(serverWakePipe[0], drained, sizeof(drained)) > 0) {
+            }
+        }
+        if (polled[0].revents & POLLIN) {
+            int client = accept(serverSocket, nullptr, nullptr);
+            if (client >= 0) {
+#if !defined(MSG_NOSIGNAL) && defined(SO_NOSIGPIPE)
+                int noSigPipe = 1;
+                setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+#endif
+                std::lock_guard<std::mutex> lock(serverMutex);
+                serverClients[client];
+            }
+        }
+        for (size_t i = 2; i < polled.size(); ++i) {
+            if (!polled[i].revents) {
+                continue;
+            }
+            int client = polled[i].fd;
+            if (!readClientRequests(client, serverClients[client])) {
+                std::lock_guard<std::mutex> lock(serverMutex);
+                serverClients.erase(client);
+                close(client);
+            }
         }
-        
-        maxFlow += pathFlow;
     }
-    
-    return maxFlow;
 }
 
-void calculateShortestPath(int startId, int endId) {
-    if (connections.empty()) {
-        std::cout << "Set pusta." << std::endl;
-        return;
-    }
-    
-    if (!stationExists(startId)) {
-        std::cout << "Nachalnaja KS s ID " << startId << " ne sushhestvuet." << std::endl;
+bool queryServerRunning() {
+    return serverSocket >= 0;
+}
+
+void stopQueryServer() {
+    if (!queryServerRunning()) {
         return;
     }
-    
-    if (!stationExists(endId)) {
-        std::cout << "Konechnaja KS s ID " << endId << " ne sushhestvuet." << std::endl;
-        return;
+    serverStopping.store(true);
+    wakeServerEventLoop();
+    serverEventThread.join();
+
+    {
+        std::lock_guard<std::mutex> lock(serverMutex);
+        for (const auto& entry : serverClients) {
+            shutdown(entry.first, SHUT_RDWR);
+        }
     }
-    
-    if (startId == endId) {
-        std::cout << "Nachalnaja i konechnaja KS ne mogut byt odnoj i toj zhe." << std::endl;
-        return;
+    serverCondition.notify_all();
+    for (auto& worker : serverWorkers) {
+        worker.join();
     }
-    
-    std::map<int, std::vector<std::pair<int, double>>> graph;
-    
-    for (const auto& conn : connections) {
-        double weight = 0.0;
-        for (const auto& pipe : pipes) {
-            if (pipe.id == conn.pipeId) {
-                weight = pipe.getWeight();
-                break;
-            }
-        }
-        
-        graph[conn.fromStationId].push_back({conn.toStationId, weight});
+    serverWorkers.clear();
+    for (const auto& entry : serverClients) {
+        close(entry.first);
     }
-    
-    std::map<int, double> dist;
-    std::map<int, int> parent;
-    std::set<std::pair<double, int>> pq;
-    
-    for (const auto& station : stations) {
-        dist[station.id] = std::numeric_limits<double>::infinity();
+    serverClients.clear();
+    serverJobs = std::queue<ServerJob>();
+
+    close(serverWakePipe[0]);
+    close(serverWakePipe[1]);
+    close(serverSocket);
+    unlink(serverSocketPath.c_str());
+    serverSocket = -1;
+    snapshotPublishing.store(false);
+}
+
+bool startQueryServer(const std::string& socketPath) {
+    sockaddr_un address{};
+    if (queryServerRunning() || socketPath.size() >= sizeof(address.sun_path)) {
+        return false;
     }
-    dist[startId] = 0.0;
-    parent[startId] = -1;
-    
-    pq.insert({0.0, startId});
-    
-    while (!pq.empty()) {
-        auto [currentDist, current] = *pq.begin();
-        pq.erase(pq.begin());
-        
-        if (current == endId) {
-            break;
-        }
-        
-        for (const auto& [neighbor, weight] : graph[current]) {
-            double newDist = currentDist + weight;
-            
-            if (newDist < dist[neighbor]) {
-                pq.erase({dist[neighbor], neighbor});
-                dist[neighbor] = newDist;
-                parent[neighbor] = current;
-                pq.insert({newDist, neighbor});
-            }
-        }
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        return false;
     }
-    
-    if (dist[endId] == std::numeric_limits<double>::infinity()) {
-        std::cout << "Put mezhdu KS " << startId << " i KS " << endId << " ne najden." << std::endl;
-        return;
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+    unlink(socketPath.c_str());
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        listen(listener, SOMAXCONN) < 0 || pipe(serverWakePipe) < 0) {
+        close(listener);
+        return false;
     }
-    
-    std::vector<int> path;
-    for (int v = endId; v != -1; v = parent[v]) {
-        path.push_back(v);
+    fcntl(serverWakePipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(serverWakePipe[1], F_SETFL, O_NONBLOCK);
+
+#if !defined(MSG_NOSIGNAL) && !defined(SO_NOSIGPIPE)
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+    snapshotPublishing.store(true);
+    publishSnapshot();
+
+    serverSocket = listener;
+    serverSocketPath = socketPath;
+    serverStopping.store(false);
+    size_t threadCount = std::max(2u, std::thread::hardware_concurrency());
+    for (size_t i = 0; i < threadCount; ++i) {
+        serverWorkers.emplace_back(serverWorkerLoop);
     }
-    std::reverse(path.begin(), path.end());
-    
-    std::cout << "\n=== KRATCHAISHIJ PUT ===" << std::endl;
-    std::cout << "Ot KS " << startId << " do KS " << endId << std::endl;
-    std::cout << "Obshhaja dlina: " << dist[endId] << " km" << std::endl;
-    std::cout << "Marshrut: ";
-    
-    for (size_t i = 0; i < path.size(); ++i) {
-        std::string stationName = "N/A";
-        for (const auto& station : stations) {
-            if (station.id == path[i]) {
-                stationName = station.name;
-                break;
-            }
-        }
-        std::cout << "KS " << path[i] << " (" << stationName << ")";
-        if (i < path.size() - 1) {
-            std::cout << " -> ";
-        }
+    serverEventThread = std::thread(serverEventLoop);
+
+    static bool exitHandlerRegistered = false;
+    if (!exitHandlerRegistered) {
+        std::atexit(stopQueryServer);
+        exitHandlerRegistered = true;
     }
-    std::cout << std::endl;
+    return true;
 }
 
-void maxFlowMenu() {
-    if (stations.empty()) {
-        std::cout << "Net KS dlja rascheta." << std::endl;
-        return;
-    }
-    
-    std::cout << "Vvedite ID KS istochnika: ";
-    int sourceId;
-    std::cin >> sourceId;
-    
-    std::cout << "Vvedite ID KS stoka: ";
-    int sinkId;
-    std::cin >> sinkId;
-    clearInputBuffer();
-    
-    double maxFlow = calculateMaxFlow(sourceId, sinkId);
-    
-    std::cout << "\n=== MAKSIMALNYJ POTOK ===" << std::endl;
-    std::cout << "Ot KS " << sourceId << " do KS " << sinkId << std::endl;
-    std::cout << "Maksimalnyj potok: " << maxFlow << " ed." << std::endl;
-    
-    logAction("Raschet maksimalnogo potoka: KS " + std::to_string(sourceId) + 
-              " -> KS " + std::to_string(sinkId) + " = " + std::to_string(maxFlow) + " ed.");
+#else
+
+bool queryServerRunning() {
+    return false;
 }
 
-void shortestPathMenu() {
-    if (stations.empty()) {
-        std::cout << "Net KS dlja rascheta." << std::endl;
+void stopQueryServer() {
+}
+
+bool startQueryServer(const std::string&) {
+    return false;
+}
+
+#endif
+
+void queryServerMenu() {
+    if (queryServerRunning()) {
+        stopQueryServer();
+        logAction("Server zaprosov ostanovlen");
+        std::cout << "Server zaprosov ostanovlen." << std::endl;
         return;
     }
-    
-    std::cout << "Vvedite ID nachalnoj KS: ";
-    int startId;
-    std::cin >> startId;
-    
-    std::cout << "Vvedite ID konechnoj KS: ";
-    int endId;
-    std::cin >> endId;
-    clearInputBuffer();
-    
-    calculateShortestPath(startId, endId);
+
+    std::cout << "Vvedite put k soketu servera: ";
+    std::string socketPath;
+    std::getline(std::cin, socketPath);
+
+    if (startQueryServer(socketPath)) {
+        logAction("Server zaprosov zapushhen: " + socketPath);
+        std::cout << "Server zaprosov zapushhen: " << socketPath << std::endl;
+        std::cout << "Komandy: PING, MAXFLOW <ID> <ID> [INT], PATH <ID> <ID> [INT], TOPO" << std::endl;
+    } else {
+        std::cout << "Oshibka zapuska servera zaprosov!" << std::endl;
+    }
 }
 
 void editCompressorStation() {
@@ -660,6 +3554,10 @@ void editCompressorStation() {
             }
             
             clearInputBuffer();
+            markChanged(changedStationChunks, stations, station);
+            journalAppend(stationRecord(station));
+            networkChanged("Otredaktirovana KS ID: " + std::to_string(station.id));
+            reachabilityUnaffected();
             logAction("Otredaktirovana KS ID: " + std::to_string(station.id));
             std::cout << "Kompressornaja stancija uspeshno otredaktirovana!" << std::endl;
             return;
@@ -709,6 +3607,10 @@ void editPipe() {
             }
             
             clearInputBuffer();
+            markChanged(changedPipeChunks, pipes, pipe);
+            journalAppend(pipeRecord(pipe));
+            networkChanged("Otredaktirovana truba ID: " + std::to_string(pipe.id));
+            reachabilityUnaffected();
             logAction("Otredaktirovana truba ID: " + std::to_string(pipe.id));
             std::cout << "Truba uspeshno otredaktirovana!" << std::endl;
             return;
@@ -717,6 +3619,120 @@ void editPipe() {
     std::cout << "Truba s ID " << id << " ne najdena." << std::endl;
 }
 
+// Menjaet priznak remonta u vseh trub, podhodjashhih pod uslovie, za odin prohod.
+// Truby v ispolzovanii tozhe mozhno vyvesti v remont: soedinenie ostaetsja,
+// no proizvoditelnost truby stanovitsja nulevoj.
+template <typename Predicate>
+std::vector<int> setPipesRepairState(Predicate selected, bool repair) {
+    std::vector<int> changedIds;
+    for (auto& pipe : pipes) {
+        if (pipe.underRepair != repair && selected(pipe)) {
+            pipe.underRepair = repair;
+            markChanged(changedPipeChunks, pipes, pipe);
+            changedIds.push_back(pipe.id);
+        }
+    }
+    return changedIds;
+}
+
+void batchRepairMenu() {
+    if (pipes.empty()) {
+        std::cout << "Net trub dlja izmenenija." << std::endl;
+        return;
+    }
+
+    std::cout << "1 - Vyvesti v remont, 0 - Vernut iz remonta: ";
+    int repairChoice;
+    while (!(std::cin >> repairChoice) || (repairChoice != 0 && repairChoice != 1)) {
+        std::cout << "Nevernyj vvod. Vvedite 0 ili 1: ";
+        clearInputBuffer();
+    }
+    bool repair = (repairChoice == 1);
+
+    std::cout << "Vybor trub: 1 - po spisku ID, 2 - po diapazonu ID, 3 - po filtru: ";
+    int mode;
+    while (!(std::cin >> mode) || mode < 1 || mode > 3) {
+        std::cout << "Nevernyj vvod. Vvedite 1, 2 ili 3: ";
+        clearInputBuffer();
+    }
+    clearInputBuffer();
+
+    std::vector<int> changedIds;
+
+    if (mode == 1) {
+        std::cout << "Vvedite ID trub cherez probel: ";
+        std::string line;
+        std::getline(std::cin, line);
+        std::istringstream input(line);
+        std::set<int> ids;
+        int id;
+        while (input >> id) {
+            ids.insert(id);
+        }
+        changedIds = setPipesRepairState([&ids](const Pipe& pipe) {
+            return ids.count(pipe.id) > 0;
+        }, repair);
+    } else if (mode == 2) {
+        int fromId, toId;
+        std::cout << "Vvedite nachalnyj ID: ";
+        while (!(std::cin >> fromId)) {
+            std::cout << "Nevernyj vvod. Vvedite celoe chislo: ";
+            clearInputBuffer();
+        }
+        std::cout << "Vvedite konechnyj ID: ";
+        while (!(std::cin >> toId) || toId < fromId) {
+            std::cout << "Nevernyj vvod. Vvedite celoe chislo ne menshe " << fromId << ": ";
+            clearInputBuffer();
+        }
+        clearInputBuffer();
+        changedIds = setPipesRepairState([fromId, toId](const Pipe& pipe) {
+            return pipe.id >= fromId && pipe.id <= toId;
+        }, repair);
+    } else {
+        std::cout << "Vvedite chast nazvanija (pustaja stroka - ljuboe): ";
+        std::string namePart;
+        std::getline(std::cin, namePart);
+        std::cout << "Vvedite diametr (0 - ljuboj): ";
+        int diameter;
+        while (!(std::cin >> diameter) ||
+               (diameter != 0 && diameter != 500 && diameter != 700 &&
+                diameter != 1000 && diameter != 1400)) {
+            std::cout << "Nevernyj vvod. Vvedite 0, 500, 700, 1000 ili 1400: ";
+            clearInputBuffer();
+        }
+        clearInputBuffer();
+        changedIds = setPipesRepairState([&namePart, diameter](const Pipe& pipe) {
+            return (diameter == 0 || pipe.diameter == diameter) &&
+                   (namePart.empty() || pipe.name.find(namePart) != std::string::npos);
+        }, repair);
+    }
+
+    if (!changedIds.empty()) {
+        std::string record = std::string("R ") + (repair ? "1" : "0");
+        for (int id : changedIds) {
+            record += " " + std::to_string(id);
+        }
+        journalAppend(record);
+        networkChanged(std::string(repair ? "Vyvedeno v remont" : "Vozvrashheno iz remonta") +
+                       " trub: " + std::to_string(changedIds.size()));
+        std::set<int> changed(changedIds.begin(), changedIds.end());
+        bool touchesNetwork = false;
+        for (const auto& pipe : pipes) {
+            if (pipe.inUse && changed.count(pipe.id)) {
+                touchesNetwork = true;
+                break;
+            }
+        }
+        if (!touchesNetwork) {
+            reachabilityUnaffected();
+        }
+    }
+
+    logAction(std::string(repair ? "Vyvedeno v remont" : "Vozvrashheno iz remonta") +
+              " trub: " + std::to_string(changedIds.size()));
+    std::cout << "Izmeneno trub: " << changedIds.size() << std::endl;
+}
+
 void deletePipe() {
     if (pipes.empty()) {
         std::cout << "Net trub dlja udalenija." << std::endl;
@@ -737,7 +3753,11 @@ void deletePipe() {
     
     for (auto it = pipes.begin(); it != pipes.end(); ++it) {
         if (it->id == id) {
+            markShifted(changedPipeChunks, it - pipes.begin());
             pipes.erase(it);
+            journalAppend("XP " + std::to_string(id));
+            networkChanged("Udalena truba ID: " + std::to_string(id));
+            reachabilityUnaffected();
             logAction("Udalena truba ID: " + std::to_string(id));
             std::cout << "Truba uspeshno udalena!" << std::endl;
             return;
@@ -766,7 +3786,11 @@ void deleteCompressorStation() {
     
     for (auto it = stations.begin(); it != stations.end(); ++it) {
         if (it->id == id) {
+            markShifted(changedStationChunks, it - stations.begin());
             stations.erase(it);
+            journalAppend("XS " + std::to_string(id));
+            networkChanged("Udalena KS ID: " + std::to_string(id));
+            reachabilityUnaffected();
             logAction("Udalena KS ID: " + std::to_string(id));
             std::cout << "Kompressornaja stancija uspeshno udalena!" << std::endl;
             return;
@@ -782,34 +3806,8 @@ void saveToFile() {
     
     std::ofstream file(filename);
     if (file.is_open()) {
-        file << nextPipeId << std::endl;
-        file << nextStationId << std::endl;
-        
-        file << pipes.size() << std::endl;
-        for (const auto& pipe : pipes) {
-            file << pipe.id << std::endl;
-            file << pipe.name << std::endl;
-            file << pipe.length << std::endl;
-            file << pipe.diameter << std::endl;
-            file << pipe.underRepair << std::endl;
-            file << pipe.inUse << std::endl;
-        }
-        
-        file << stations.size() << std::endl;
-        for (const auto& station : stations) {
-            file << station.id << std::endl;
-            file << station.name << std::endl;
-            file << station.totalWorkshops << std::endl;
-            file << station.workingWorkshops << std::endl;
-            file << station.stationClass << std::endl;
-        }
-        
-        file << connections.size() << std::endl;
-        for (const auto& conn : connections) {
-            file << conn.pipeId << std::endl;
-            file << conn.fromStationId << std::endl;
-            file << conn.toStationId << std::endl;
-        }
+        writeNetwork(file);
+        journalCommit(true);
         
         logAction("Sohranenie dannyh v fajl: " + filename);
         std::cout << "Dannyye uspeshno sohraneny v fajl: " << filename << std::endl;
@@ -823,58 +3821,16 @@ void loadFromFile() {
     std::cout << "Vvedite imja fajla dlja zagruzki: ";
     std::getline(std::cin, filename);
     
-    std::ifstream file(filename);
-    if (file.is_open()) {
-        pipes.clear();
-        stations.clear();
-        connections.clear();
-        
-        file >> nextPipeId;
-        file >> nextStationId;
-        clearInputBuffer();
-        
-        int pipeCount;
-        file >> pipeCount;
-        clearInputBuffer();
-        for (int i = 0; i < pipeCount; i++) {
-            Pipe pipe;
-            file >> pipe.id;
-            clearInputBuffer();
-            std::getline(file, pipe.name);
-            file >> pipe.length;
-            file >> pipe.diameter;
-            file >> pipe.underRepair;
-            file >> pipe.inUse;
-            clearInputBuffer();
-            pipes.push_back(pipe);
-        }
-        
-        int stationCount;
-        file >> stationCount;
-        clearInputBuffer();
-        for (int i = 0; i < stationCount; i++) {
-            CompressorStation station;
-            file >> station.id;
-            clearInputBuffer();
-            std::getline(file, station.name);
-            file >> station.totalWorkshops;
-            file >> station.workingWorkshops;
-            file >> station.stationClass;
-            clearInputBuffer();
-            stations.push_back(station);
+    std::string data, error;
+    if (readFileBlock(filename, data)) {
+        if (!parseNetwork(data, error)) {
+            std::cout << "Oshibka formata fajla " << filename << ": " << error << std::endl;
+            return;
         }
-        
-        int connCount;
-        file >> connCount;
-        clearInputBuffer();
-        for (int i = 0; i < connCount; i++) {
-            NetworkConnection conn;
-            file >> conn.pipeId;
-            file >> conn.fromStationId;
-            file >> conn.toStationId;
-            clearInputBuffer();
-            connections.push_back(conn);
+        if (journalFile) {
+            compactJournal();
         }
+        networkChanged("Zagruzka dannyh iz fajla: " + filename);
         
         logAction("Zagruzka dannyh iz fajla: " + filename);
         std::cout << "Dannyye uspeshno zagruzheny iz fajla: " << filename << std::endl;